@@ -1,11 +1,14 @@
 // the file IM2D_functions needs to be the same directory as this file
-// 2-Dimensional Ising model with update paths: random, order, Hilbert curve, Lebesque curve, Gcurve
+// 2-Dimensional Ising model with update paths: random, order, Hilbert curve, Lebesque curve, Gcurve,
+// checkerboard order on the bit-packed lattice, and multithreaded checkerboard order
 // running the model and outputting the data; the constants and functions are in the header file
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <time.h>
+#include <stdint.h>
+#include <pthread.h>
 
 // constants and functions 
 #include "IM2D_Functions.h" 
@@ -24,8 +27,9 @@ int main(){
     fptr = fopen(name, "w");
     fprintf(fptr, "beta=%.2f\n", beta);
     // columns from left: separation, avg random, sd random, avg order, sd order, avg hilbert, sd hilbert, 
-    // avg lebesgue, sd lebesgue, avg gcurve, sd gcurve
-    fprintf(fptr, "separation,avg_random,sd_random,avg_order,sd_order,avg_hilbert,sd_hilbert,avg_lebesgue,sd_lebesgue,avg_gcurve,sd_gcurve\n");
+    // avg lebesgue, sd lebesgue, avg gcurve, sd gcurve, avg packed, sd packed,
+    // avg checkerboard, sd checkerboard
+    fprintf(fptr, "separation,avg_random,sd_random,avg_order,sd_order,avg_hilbert,sd_hilbert,avg_lebesgue,sd_lebesgue,avg_gcurve,sd_gcurve,avg_packed,sd_packed,avg_checkerboard,sd_checkerboard\n");
 
     // looping 10 times and saving all to one file
     for( int i=0; i<10; i++ ){
@@ -39,6 +43,8 @@ int main(){
         double avg_h[SEPARATION], standard_deviation_h[SEPARATION];
         double avg_l[SEPARATION], standard_deviation_l[SEPARATION]; 
         double avg_g[SEPARATION], standard_deviation_g[SEPARATION]; 
+        double avg_p[SEPARATION], standard_deviation_p[SEPARATION]; 
+        double avg_c[SEPARATION], standard_deviation_c[SEPARATION]; 
         
         // running the program to collect data for all update paths 
         Run_Random( beta, bins_number, avg_r, standard_deviation_r );
@@ -51,10 +57,14 @@ int main(){
         printf( "Lebesgue Completed - %d/10...\n", i+1 );
         Run_Gcurve( beta, bins_number, avg_g, standard_deviation_g );
         printf( "Gcurve Completed - %d/10...\n", i+1 );
+        Run_Packed( beta, bins_number, avg_p, standard_deviation_p );
+        printf( "Packed Completed - %d/10...\n", i+1 );
+        Run_Checkerboard( beta, bins_number, avg_c, standard_deviation_c );
+        printf( "Checkerboard Completed - %d/10...\n", i+1 );
         
         // outputing data into a csv file
         for ( int d=0; d<SEPARATION; d++ ){
-            fprintf(fptr,"%d,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf\n", d, avg_r[d], standard_deviation_r[d], avg_o[d], standard_deviation_o[d], avg_h[d], standard_deviation_h[d], avg_l[d], standard_deviation_l[d], avg_g[d], standard_deviation_g[d]);
+            fprintf(fptr,"%d,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf\n", d, avg_r[d], standard_deviation_r[d], avg_o[d], standard_deviation_o[d], avg_h[d], standard_deviation_h[d], avg_l[d], standard_deviation_l[d], avg_g[d], standard_deviation_g[d], avg_p[d], standard_deviation_p[d], avg_c[d], standard_deviation_c[d]);
         } 
 
     }  
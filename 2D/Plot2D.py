@@ -1,6 +1,7 @@
 #Plotting data for 2D Ising Model 
 #Columns from left: separation, avg random, sd random, avg order, sd order, 
-#avg hilbert, sd hilbert, avg lebesgue, sd lebesgue, avg gcurve, sd gcurve
+#avg hilbert, sd hilbert, avg lebesgue, sd lebesgue, avg gcurve, sd gcurve, 
+#avg packed, sd packed, avg checkerboard, sd checkerboard
 
 import numpy as np
 import pandas as pd
@@ -18,24 +19,24 @@ BS = 100 #bin size
 df = pd.read_csv( 'Data_2D_%.2f.csv' % beta, skiprows=0, header=1 )
 
 #cols 1*n are for avg.s and cols 2*n are for s.d.s
-mean = np.zeros( (11, 10) ) 
-std = np.zeros( (11, 10) ) 
+mean = np.zeros( (11, 14) ) 
+std = np.zeros( (11, 14) ) 
 
 for i in range( 0, 11, 1 ): #looping over seperation
     temp_mean = df.loc[df['separation'] == i].mean( axis=0 )[1:]
     temp_std = df.loc[df['separation'] == i].std( axis=0 )[1:]
     
-    for j in range( 0, 10, 1 ): #looping over methods
+    for j in range( 0, 14, 1 ): #looping over methods
         mean[i][j] = temp_mean[j]
         std[i][j] = temp_std[j]
 
 x = np.arange( 0, 11, 1 )
 
-labels = [ 'Random', 'Order', 'Hilbert', 'Lebesgue', 'Gcurve' ]
+labels = [ 'Random', 'Order', 'Hilbert', 'Lebesgue', 'Gcurve', 'Packed', 'Checkerboard' ]
 
 fig, ax = plt.subplots( nrows=1, ncols=2, sharex=True, figsize=(17, 6) )
 
-for i in range( 0, 5, 1 ):
+for i in range( 0, 7, 1 ):
     ax[0].errorbar( x, mean[:, 2*i], yerr=std[:, 2*i], capsize=3, 
                    label=labels[i] )
     ax[1].errorbar( x, mean[:, 2*i+1], yerr=std[:, 2*i+1], capsize=3, 
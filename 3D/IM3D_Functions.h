@@ -5,6 +5,11 @@ const int SIZE=16; // size of the lattice (total number of sites is SIZE^3)
 const int MCS = 10000; // total number of states to be generated
 const int BINS_SIZE = 100; // size of bins to average over in order to smooth out fluctuations
 const int SEPARATION = 11; // correlation will be calc. for separation of 0 to SEPARATION-1
+const int THREADS = 4; // number of threads sharing the lattice in the checkerboard update order
+const int PACKED_PRECISION = 24; // acceptance probabilities of the packed lattice are exact to 2^-PACKED_PRECISION
+
+// the packed lattice stores 64 spins per word: bit k of packed[z][y][w] is the spin at x = 64*w+k (1 = +1, 0 = -1);
+// SIZE has to be even and either at most 64 or a multiple of 64
 
 // struct used in ChoosePosition_Random and Order to return position
 typedef struct{
@@ -13,6 +18,20 @@ typedef struct{
     int z;
 } position;
 
+// struct handed to each thread of the checkerboard update order; the thread owns the slab first <= x < last
+typedef struct{
+    int id;
+    int first;
+    int last;
+    int bins_number;
+    double beta;
+    uint64_t state; // state of the thread's own random number generator
+    int *sigma; // lattice shared by all threads
+    double *partial; // correlation of each slab for the current state, one row per thread
+    double *correl_data;
+    pthread_barrier_t *barrier;
+} slab;
+
 
 void InitializeSigma( int sigma[][SIZE][SIZE] );
 position ChoosePosition_Random();
@@ -29,6 +48,22 @@ void Run_Random( double beta, int bins_number, double avg[SEPARATION], double st
 void Run_Order( double beta, int bins_number, double avg[SEPARATION], double standard_deviation[SEPARATION] );
 void Run_Hilbert( double beta, int bins_number, double avg[SEPARATION], double standard_deviation[SEPARATION] );
 void Run_Lebesgue( double beta, int bins_number, double avg[SEPARATION], double standard_deviation[SEPARATION] );
+uint64_t RandomWord();
+unsigned long PackedDigits( double p );
+uint64_t BernoulliWord( unsigned long digits, uint64_t *state );
+uint64_t PackedMask( int parity );
+uint64_t PackedBits( uint64_t row[], int start );
+void InitialiseSigma_Packed( int words, uint64_t packed[][SIZE][words] );
+void DeltaU_Packed( int words, uint64_t packed[][SIZE][words], int y, int z, int w, uint64_t count[3] );
+uint64_t TestFlip_Packed( uint64_t count[3], unsigned long digits, uint64_t *state );
+void Correlation_Packed( int a, int N, int words, uint64_t packed[][SIZE][words], double correl_data[][SEPARATION] );
+uint64_t RandomBits( uint64_t *state );
+double RandomUniform( uint64_t *state );
+int TestFlip_Slab( int e, double beta, uint64_t *state );
+void Correlation_Slab( int first, int last, int N, int sigma[][SIZE][SIZE], double partial[] );
+void *Checkerboard_Slab( void *arg );
+void Run_Checkerboard( double beta, int bins_number, double avg[SEPARATION], double standard_deviation[SEPARATION] );
+void Run_Packed( double beta, int bins_number, double avg[SEPARATION], double standard_deviation[SEPARATION] );
 
 
 void InitializeSigma( int sigma[][SIZE][SIZE] ){
@@ -361,3 +396,339 @@ void Run_Lebesgue( double beta, int bins_number, double avg[SEPARATION], double
     Average( bins_number, correl_data, avg );
     StandardDeviation( bins_number, correl_data, avg, standard_deviation );
 }
+
+uint64_t RandomWord(){
+    // return 64 random bits built from 15-bit pieces of rand(), used for the initial lattice and to seed generators
+    uint64_t word = 0;
+    for ( int i=0; i<5; i++ ){
+        word = (word << 15) ^ (uint64_t)(rand() & 0x7fff);
+    }
+    return word;
+}
+
+unsigned long PackedDigits( double p ){
+    // return the first PACKED_PRECISION binary digits of the probability p, or 1 << PACKED_PRECISION if p >= 1
+    if ( p >= 1 ){
+        return 1UL << PACKED_PRECISION;
+    }
+    return (unsigned long)( p*(double)(1UL << PACKED_PRECISION) );
+}
+
+uint64_t BernoulliWord( unsigned long digits, uint64_t *state ){
+    // return a word whose bits are set independently with the probability of the given binary digits (from
+    // PackedDigits), one random word of the generator per digit from the lowest set one up
+    if ( digits >> PACKED_PRECISION ){
+        return ~(uint64_t)0;
+    }
+
+    uint64_t mask = 0;
+    for ( int i=0; i<PACKED_PRECISION; i++ ){
+        if ( (digits >> i) & 1 ){
+            mask |= RandomBits( state );
+        }
+        else if ( mask != 0 ){
+            mask &= RandomBits( state );
+        }
+    }
+    return mask;
+}
+
+uint64_t PackedMask( int parity ){
+    // return the bits of a word that hold sites of the sublattice (x+y+z)%2 == parity
+    uint64_t valid = ~(uint64_t)0;
+    if ( SIZE < 64 ){
+        valid = ((uint64_t)1 << (SIZE%64)) - 1;
+    }
+
+    if ( parity%2 == 0 ){
+        return valid & 0x5555555555555555ULL;
+    }
+    else{
+        return valid & 0xAAAAAAAAAAAAAAAAULL;
+    }
+}
+
+uint64_t PackedBits( uint64_t row[], int start ){
+    // return the 64 spins of a row starting at x = start, wrapping around periodically
+    start = ( start%SIZE + SIZE )%SIZE;
+
+    if ( SIZE < 64 ){
+        uint64_t valid = ((uint64_t)1 << (SIZE%64)) - 1;
+        return ( (row[0] >> start) | (row[0] << (SIZE-start)) ) & valid;
+    }
+
+    int words = SIZE/64;
+    int w = start/64;
+    int offset = start%64;
+    if ( offset == 0 ){
+        return row[w];
+    }
+    return (row[w] >> offset) | (row[(w+1)%words] << (64-offset));
+}
+
+void InitialiseSigma_Packed( int words, uint64_t packed[][SIZE][words] ){
+    // initialise the packed lattice by randomly assigning +/- 1 to every bit
+    for ( int z=0; z<SIZE; z++ ){
+        for ( int y=0; y<SIZE; y++ ){
+            for ( int w=0; w<words; w++ ){
+                packed[z][y][w] = RandomWord() & ( PackedMask( 0 ) | PackedMask( 1 ) );
+            }
+        }
+    }
+}
+
+void DeltaU_Packed( int words, uint64_t packed[][SIZE][words], int y, int z, int w, uint64_t count[3] ){
+    // count, bit by bit, the neighbours anti-parallel to the 64 spins of word w in row (y, z);
+    // count[i] holds bit i of the count, the energy difference after a flip is 12-4*count
+    int up, down, front, back;
+
+    if ( y==SIZE-1 ){
+        front = 0;
+    }
+    else{
+        front = y+1;
+    }
+    if ( y==0 ){
+        back = SIZE-1;
+    }
+    else{
+        back = y-1;
+    }
+    if ( z==SIZE-1 ){
+        up = 0;
+    }
+    else{
+        up = z+1;
+    }
+    if ( z==0 ){
+        down = SIZE-1;
+    }
+    else{
+        down = z-1;
+    }
+
+    uint64_t s = packed[z][y][w];
+    uint64_t anti[6] = { s ^ packed[z][front][w], s ^ packed[z][back][w], s ^ packed[up][y][w], s ^ packed[down][y][w],
+                         s ^ PackedBits( packed[z][y], 64*w+1 ), s ^ PackedBits( packed[z][y], 64*w-1 ) };
+
+    count[0] = count[1] = count[2] = 0;
+    for ( int i=0; i<6; i++ ){
+        uint64_t carry0 = count[0] & anti[i];
+        count[0] ^= anti[i];
+        uint64_t carry1 = count[1] & carry0;
+        count[1] ^= carry0;
+        count[2] |= carry1;
+    }
+}
+
+uint64_t TestFlip_Packed( uint64_t count[3], unsigned long digits, uint64_t *state ){
+    // return the bits which should be flipped: always for count >= 3 (e <= 0), otherwise with
+    // probability p = exp(-4*beta) to the power of 3-count, as a product of independent random masks; digits holds
+    // the binary digits of p, the masks come from the generator state
+    uint64_t accept = count[2] | (count[1] & count[0]);
+    uint64_t two = count[1] & ~count[0] & ~count[2];
+    uint64_t one = count[0] & ~count[1] & ~count[2];
+    uint64_t zero = ~(count[0] | count[1] | count[2]);
+
+    uint64_t pending = two | one | zero;
+    uint64_t m = ~(uint64_t)0;
+    for ( int i=0; i<3 && pending != 0; i++ ){
+        m &= BernoulliWord( digits, state );
+        accept |= two & m;
+        two = one;
+        one = zero;
+        zero = 0;
+        pending = (two | one) & m;
+    }
+    return accept;
+}
+
+void Correlation_Packed( int a, int N, int words, uint64_t packed[][SIZE][words], double correl_data[][SEPARATION] ){
+    // calculate the correletion between a site and a site 'd' away using popcount of the anti-parallel pairs
+    double norm = N*BINS_SIZE;
+
+    for ( int d=0; d<SEPARATION; d++ ){
+        long anti = 0;
+        for ( int z=0; z<SIZE; z++ ){
+            for ( int y=0; y<SIZE; y++ ){
+                for ( int w=0; w<words; w++ ){
+                    uint64_t valid = PackedMask( 0 ) | PackedMask( 1 );
+                    anti += __builtin_popcountll( (packed[z][y][w] ^ PackedBits( packed[z][y], 64*w+d )) & valid );
+                }
+            }
+        }
+        correl_data[a][d] += (double)(N - 2*anti)/norm;
+    }
+}
+
+void Run_Packed( double beta, int bins_number, double avg[SEPARATION], double standard_deviation[SEPARATION] ){
+    // run the metropolis algorithm on the packed lattice (checkerboard order), find avg. and s.d.
+    int N = SIZE*SIZE*SIZE;
+
+    if ( SIZE%2 != 0 || (SIZE > 64 && SIZE%64 != 0) ){
+        printf( "Packed lattice needs an even SIZE of at most 64 or a multiple of 64\n" );
+        return;
+    }
+
+    int words = (SIZE+63)/64;
+    uint64_t packed[SIZE][SIZE][words];
+    InitialiseSigma_Packed( words, packed );
+
+    double correl_data[bins_number][SEPARATION];
+    InitializeCorrelation( bins_number, correl_data );
+
+    // the acceptance probability is split into its binary digits once per run
+    unsigned long digits = PackedDigits( exp( -4*beta ) );
+    uint64_t state = RandomWord() | 1;
+    uint64_t count[3];
+    for ( int a=0; a<bins_number; a++ ){
+        for ( int b=0; b<BINS_SIZE; b++ ){
+            for ( int parity=0; parity<2; parity++ ){
+                for ( int z=0; z<SIZE; z++ ){
+                    for ( int y=0; y<SIZE; y++ ){
+                        for ( int w=0; w<words; w++ ){
+                            DeltaU_Packed( words, packed, y, z, w, count );
+                            packed[z][y][w] ^= TestFlip_Packed( count, digits, &state ) & PackedMask( parity+y+z );
+                        }
+                    }
+                }
+            }
+            Correlation_Packed( a, N, words, packed, correl_data );
+        }
+    }
+    Average( bins_number, correl_data, avg );
+    StandardDeviation( bins_number, correl_data, avg, standard_deviation );
+}
+
+uint64_t RandomBits( uint64_t *state ){
+    // return 64 random bits from a thread's own xorshift64* generator
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+double RandomUniform( uint64_t *state ){
+    // return a random number in [0, 1) from a thread's own xorshift64* generator
+    return (double)( RandomBits( state ) >> 11 )/9007199254740992.0;
+}
+
+int TestFlip_Slab( int e, double beta, uint64_t *state ){
+    // test whether the site should be flipped using the thread's generator: yes = return 0; no = return 1
+    if ( e <= 0 ){
+        return 0;
+    }
+    else if ( RandomUniform( state ) < exp( -e*beta ) ){
+        return 0;
+    }
+    else{
+        return 1;
+    }
+}
+
+void Correlation_Slab( int first, int last, int N, int sigma[][SIZE][SIZE], double partial[] ){
+    // calculate the correletion of the sites first <= x < last with the sites 'd' away
+    double norm = N*BINS_SIZE;
+
+    for ( int d=0; d<SEPARATION; d++ ){
+        partial[d] = 0;
+        for ( int x=first; x<last; x++ ){
+            for ( int y=0; y<SIZE; y++ ){
+                for ( int z=0; z<SIZE; z++ ){
+                    if ( x+d < SIZE ){
+                        partial[d] += (double)(sigma[x][y][z]*sigma[x+d][y][z])/norm;
+                    }
+                    else{
+                        partial[d] += (double)(sigma[x][y][z]*sigma[x+d-SIZE][y][z])/norm;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void *Checkerboard_Slab( void *arg ){
+    // update the slab of one thread: one sublattice (x+y+z)%2 == parity per half-sweep, the threads meet
+    // at a barrier after each half-sweep and after each correlation measurement
+    slab *task = (slab *)arg;
+    int (*sigma)[SIZE][SIZE] = (int (*)[SIZE][SIZE])task->sigma;
+    double (*partial)[SEPARATION] = (double (*)[SEPARATION])task->partial;
+    double (*correl_data)[SEPARATION] = (double (*)[SEPARATION])task->correl_data;
+    int N = SIZE*SIZE*SIZE;
+    int threads = SIZE < THREADS ? SIZE : THREADS;
+
+    int e;
+    for ( int a=0; a<task->bins_number; a++ ){
+        for ( int b=0; b<BINS_SIZE; b++ ){
+            for ( int parity=0; parity<2; parity++ ){
+                for ( int x=task->first; x<task->last; x++ ){
+                    for ( int y=0; y<SIZE; y++ ){
+                        for ( int z=(x+y+parity)%2; z<SIZE; z+=2 ){
+                            e = DeltaU( sigma, x, y, z );
+                            if ( TestFlip_Slab( e, task->beta, &task->state ) == 0 ){
+                                sigma[x][y][z] = -sigma[x][y][z];
+                            }
+                        }
+                    }
+                }
+                pthread_barrier_wait( task->barrier );
+            }
+            Correlation_Slab( task->first, task->last, N, sigma, partial[task->id] );
+            pthread_barrier_wait( task->barrier );
+            if ( task->id == 0 ){
+                for ( int t=0; t<threads; t++ ){
+                    for ( int d=0; d<SEPARATION; d++ ){
+                        correl_data[a][d] += partial[t][d];
+                    }
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+void Run_Checkerboard( double beta, int bins_number, double avg[SEPARATION], double standard_deviation[SEPARATION] ){
+    // run the metropolis algorithm in checkerboard order on THREADS threads, find avg. and s.d.
+    if ( SIZE%2 != 0 ){
+        printf( "Checkerboard order needs an even SIZE\n" );
+        return;
+    }
+
+    int sigma[SIZE][SIZE][SIZE];
+    InitializeSigma( sigma );
+
+    double correl_data[bins_number][SEPARATION];
+    InitializeCorrelation( bins_number, correl_data );
+
+    // every thread gets a slab of whole x planes and its own generator seeded from rand()
+    int threads = SIZE < THREADS ? SIZE : THREADS;
+    double partial[threads][SEPARATION];
+    slab tasks[threads];
+    pthread_t handles[threads];
+    pthread_barrier_t barrier;
+    pthread_barrier_init( &barrier, NULL, threads );
+
+    for ( int t=0; t<threads; t++ ){
+        tasks[t].id = t;
+        tasks[t].first = t*SIZE/threads;
+        tasks[t].last = (t+1)*SIZE/threads;
+        tasks[t].bins_number = bins_number;
+        tasks[t].beta = beta;
+        tasks[t].state = RandomWord() | 1;
+        tasks[t].sigma = (int *)sigma;
+        tasks[t].partial = &partial[0][0];
+        tasks[t].correl_data = &correl_data[0][0];
+        tasks[t].barrier = &barrier;
+    }
+    for ( int t=1; t<threads; t++ ){
+        pthread_create( &handles[t], NULL, Checkerboard_Slab, &tasks[t] );
+    }
+    Checkerboard_Slab( &tasks[0] );
+    for ( int t=1; t<threads; t++ ){
+        pthread_join( handles[t], NULL );
+    }
+    pthread_barrier_destroy( &barrier );
+
+    Average( bins_number, correl_data, avg );
+    StandardDeviation( bins_number, correl_data, avg, standard_deviation );
+}
@@ -0,0 +1,81 @@
+// the file IMND_functions needs to be the same directory as this file
+// Ising model in 1, 2 or 3 dimensions with update paths: random, order, every 2nd, every 3rd, Hilbert curve,
+// Lebesque curve, Gcurve, checkerboard; a sweep over dimensions, sizes, temperatures and orders is chosen on
+// the command line or in a config file and its jobs run in parallel
+// running the model and outputting the data; the constants and functions are in the header files
+// compile with: gcc -O2 IMND.c -o IMND -lm -pthread
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+// random numbers, memory, statistics, autocorrelation, checkpoints, hardware counters, telemetry, replica exchange,
+// fft, update orders, constants and functions, batches of repetitions, parameter sweeps, binary output
+#include "IMND_Random.h"
+#include "IMND_Arena.h"
+#include "IMND_Stats.h"
+#include "IMND_Autocorr.h"
+#include "IMND_Checkpoint.h"
+#include "IMND_Counters.h"
+#include "IMND_Telemetry.h"
+#include "IMND_Tempering.h"
+#include "IMND_FFT.h"
+#include "IMND_Orders.h"
+#include "IMND_Functions.h"
+#include "IMND_Batch.h"
+#include "IMND_Schedule.h"
+#include "IMND_Binary.h"
+
+int main( int argc, char *argv[] ){
+
+    grid g;
+    if ( ParseGrid( argc, argv, &g ) ){
+        return 1;
+    }
+    printf( "Seed: %llu\n", (unsigned long long)g.base.seed );
+
+    job *jobs;
+    long jobs_number = BuildJobs( &g, &jobs );
+    FILE *binary = NULL;
+    if ( g.binary[0] != 0 ){
+        binary = BinaryOpen( g.binary, jobs, jobs_number );
+        if ( binary == NULL ){
+            FreeJobs( jobs, jobs_number );
+            return 1;
+        }
+    }
+    printf( "The process has been started with %ld jobs on %d threads...\n", jobs_number, g.workers );
+
+    RunJobs( g.workers, jobs, jobs_number, g.status[0] != 0 ? g.status : NULL, g.status_every );
+
+    // outputing data of all jobs into one csv file
+    WriteResults( g.output, jobs, jobs_number );
+    if ( g.base.series ){
+        WriteAutocorrelation( g.autocorrelation, jobs, jobs_number );
+    }
+    if ( g.base.counters ){
+        WriteCounters( g.counters, jobs, jobs_number );
+    }
+    if ( binary != NULL ){
+        BinaryClose( binary, jobs, jobs_number );
+    }
+    FreeJobs( jobs, jobs_number );
+    FreeOrderTables();
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+// this file needs to be in the same directory as the main file
+// memory of large lattices: everything a job needs (lattice, tables, accumulators) is carved out of one arena
+// mapped with mmap, backed by explicit or transparent huge pages to cut TLB misses; nothing lives on the stack
+
+#define ARENA_ALIGN 64 // alignment of every allocation (one cache line)
+#define HUGE_PAGE ((size_t)2 << 20) // size of a huge page
+
+// pages backing the arenas: normal, transparent huge pages (madvise) or reserved huge pages (MAP_HUGETLB)
+enum{ PAGES_NORMAL, PAGES_TRANSPARENT, PAGES_EXPLICIT, PAGE_KINDS };
+const char *PAGE_NAMES[PAGE_KINDS] = { "normal", "transparent", "explicit" };
+
+// memory of one job, handed out from the start and released all at once
+typedef struct{
+    char *base;
+    size_t capacity;
+    size_t used;
+} arena;
+
+
+int ParsePages( const char *name );
+size_t ArenaSize( size_t bytes );
+void *MapPages( size_t bytes, int pages );
+int ArenaInit( arena *a, size_t capacity, int pages );
+void *ArenaAlloc( arena *a, size_t bytes );
+void ArenaFree( arena *a );
+
+
+int ParsePages( const char *name ){
+    // return the kind of pages with the given name, or -1
+    for ( int pages=0; pages<PAGE_KINDS; pages++ ){
+        if ( strcmp( name, PAGE_NAMES[pages] ) == 0 ){
+            return pages;
+        }
+    }
+    return -1;
+}
+
+size_t ArenaSize( size_t bytes ){
+    // return the space taken in an arena by an allocation of bytes
+    return (bytes + ARENA_ALIGN-1)/ARENA_ALIGN*ARENA_ALIGN;
+}
+
+void *MapPages( size_t bytes, int pages ){
+    // map bytes (a multiple of HUGE_PAGE) of zeroed memory; explicit huge pages fall back to transparent ones
+    // when none are reserved; return NULL on failure
+    void *base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if ( pages == PAGES_EXPLICIT ){
+        base = mmap( NULL, bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0 );
+    }
+#endif
+    if ( base == MAP_FAILED ){
+        base = mmap( NULL, bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+        if ( base == MAP_FAILED ){
+            return NULL;
+        }
+#ifdef MADV_HUGEPAGE
+        if ( pages != PAGES_NORMAL ){
+            madvise( base, bytes, MADV_HUGEPAGE );
+        }
+#endif
+    }
+    return base;
+}
+
+int ArenaInit( arena *a, size_t capacity, int pages ){
+    // map an arena of at least capacity bytes, rounded up to whole huge pages; return 1 on failure
+    a->capacity = (capacity + HUGE_PAGE-1)/HUGE_PAGE*HUGE_PAGE;
+    a->used = 0;
+    a->base = MapPages( a->capacity, pages );
+    return a->base == NULL;
+}
+
+void *ArenaAlloc( arena *a, size_t bytes ){
+    // return ARENA_ALIGN aligned, zeroed memory of bytes from the arena; NULL if it is used up
+    size_t size = ArenaSize( bytes );
+    if ( a->used + size > a->capacity ){
+        return NULL;
+    }
+    void *memory = a->base + a->used;
+    a->used += size;
+    return memory;
+}
+
+void ArenaFree( arena *a ){
+    // unmap the whole arena
+    if ( a->base != NULL ){
+        munmap( a->base, a->capacity );
+    }
+    a->base = NULL;
+}
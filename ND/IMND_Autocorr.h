@@ -0,0 +1,144 @@
+// this file needs to be in the same directory as the main file
+// autocorrelation analysis: a time series of the energy, magnetisation and nearest neighbour correlation is recorded
+// after every sweep, and its integrated autocorrelation time is estimated by automatic windowing (Sokal) and checked
+// by binning; the effectively independent samples per cpu-second are what one update order buys over another
+
+#define SOKAL_WINDOW 6 // the window W is the first with W >= SOKAL_WINDOW*tau(W)
+#define MIN_BLOCKS 32 // fewest blocks of the binning analysis
+#define SERIES_SUMS 3 // sums over the lattice recorded after a sweep: spins, bonds of all axes, bonds along x
+
+// observables recorded after each sweep, per site: energy, |magnetisation| and sigma(x)*sigma(x+1) along x
+enum{ OBSERVABLE_ENERGY, OBSERVABLE_MAGNETISATION, OBSERVABLE_NEIGHBOUR, OBSERVABLES };
+const char *OBSERVABLE_NAMES[OBSERVABLES] = { "energy", "magnetisation", "neighbour" };
+
+// time series of one run, one value of each observable per sweep
+typedef struct{
+    long length; // sweeps the series has room for
+    long recorded;
+    double *values[OBSERVABLES];
+} series;
+
+// autocorrelation of one observable
+typedef struct{
+    double mean;
+    double tau; // integrated autocorrelation time in sweeps, from the automatic window
+    double tau_error; // its statistical error (Madras-Sokal)
+    long window;
+    double tau_binning; // integrated autocorrelation time from the largest bins with at least MIN_BLOCKS blocks
+    double effective; // effectively independent samples of the series
+} autocorrelation;
+
+// analysis of one run
+typedef struct{
+    double cpu_seconds; // cpu time of the run, summed over its threads
+    autocorrelation observables[OBSERVABLES];
+} analysis;
+
+
+double CpuSeconds( void );
+void SeriesInit( series *s, long length, arena *memory );
+void SeriesRecord( series *s, long n, const long sums[] );
+double Autocovariance( const double x[], long length, double mean, long t );
+void Autocorrelation_Window( const double x[], long length, autocorrelation *a );
+void Autocorrelation_Binning( const double x[], long length, autocorrelation *a );
+void Analyse( const series *s, analysis *result );
+
+
+double CpuSeconds( void ){
+    // return the cpu time used by the calling thread
+    struct timespec now;
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &now );
+    return now.tv_sec + 1e-9*now.tv_nsec;
+}
+
+void SeriesInit( series *s, long length, arena *memory ){
+    // take room for length sweeps of every observable from the arena
+    s->length = length;
+    s->recorded = 0;
+    for ( int o=0; o<OBSERVABLES; o++ ){
+        s->values[o] = ArenaAlloc( memory, length*sizeof(double) );
+    }
+}
+
+void SeriesRecord( series *s, long n, const long sums[] ){
+    // record one sweep from the sums over the n sites of the spins, the bonds of all axes and the bonds along x
+    if ( s->recorded == s->length ){
+        return;
+    }
+    s->values[OBSERVABLE_ENERGY][s->recorded] = -(double)sums[1]/n;
+    s->values[OBSERVABLE_MAGNETISATION][s->recorded] = fabs( (double)sums[0]/n );
+    s->values[OBSERVABLE_NEIGHBOUR][s->recorded] = (double)sums[2]/n;
+    s->recorded++;
+}
+
+double Autocovariance( const double x[], long length, double mean, long t ){
+    // return the autocovariance of the series at lag t
+    double sum = 0;
+    for ( long i=0; i+t<length; i++ ){
+        sum += (x[i]-mean)*(x[i+t]-mean);
+    }
+    return sum/(length-t);
+}
+
+void Autocorrelation_Window( const double x[], long length, autocorrelation *a ){
+    // sum the normalised autocorrelation up to the first window W >= SOKAL_WINDOW*tau(W); a series that never
+    // changes carries no information and gets NAN
+    double sum = 0;
+    for ( long i=0; i<length; i++ ){
+        sum += x[i];
+    }
+    a->mean = sum/length;
+
+    double variance = Autocovariance( x, length, a->mean, 0 );
+    if ( length < 2 || variance <= 0 ){
+        a->tau = NAN;
+        a->tau_error = NAN;
+        a->window = 0;
+        return;
+    }
+    a->tau = 0.5;
+    a->window = 0;
+    for ( long t=1; t<length/2; t++ ){
+        a->tau += Autocovariance( x, length, a->mean, t )/variance;
+        a->window = t;
+        if ( t >= SOKAL_WINDOW*a->tau ){
+            break;
+        }
+    }
+    a->tau_error = a->tau*sqrt( 2.0*(2*a->window+1)/length );
+}
+
+void Autocorrelation_Binning( const double x[], long length, autocorrelation *a ){
+    // tau = bins_size*var(bin means)/(2*var) for bins of 1, 2, 4, ... sweeps, taken at the largest bins that
+    // still give MIN_BLOCKS blocks, where the estimate has reached its plateau if the series is long enough
+    double variance = Autocovariance( x, length, a->mean, 0 );
+    a->tau_binning = NAN;
+    if ( length < 2*MIN_BLOCKS || variance <= 0 ){
+        return;
+    }
+    for ( long bins_size=1; length/bins_size>=MIN_BLOCKS; bins_size*=2 ){
+        long blocks = length/bins_size;
+        double mean = 0, m2 = 0;
+        for ( long k=0; k<blocks; k++ ){
+            double block = 0;
+            for ( long i=k*bins_size; i<(k+1)*bins_size; i++ ){
+                block += x[i];
+            }
+            block /= bins_size;
+            double delta = block-mean;
+            mean += delta/(k+1);
+            m2 += delta*(block-mean);
+        }
+        a->tau_binning = bins_size*(m2/(blocks-1))/(2*variance);
+    }
+}
+
+void Analyse( const series *s, analysis *result ){
+    // find the autocorrelation time and effective samples of every observable of the series
+    for ( int o=0; o<OBSERVABLES; o++ ){
+        autocorrelation *a = &result->observables[o];
+        Autocorrelation_Window( s->values[o], s->recorded, a );
+        Autocorrelation_Binning( s->values[o], s->recorded, a );
+        a->effective = s->recorded/(2*a->tau);
+    }
+}
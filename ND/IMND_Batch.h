@@ -0,0 +1,177 @@
+// this file needs to be in the same directory as the main file
+// batches of repetitions: the repetitions of one lattice, temperature and update order visit the same sites in the
+// same order, so up to 64 of them are run as the lanes of one bit-sliced lattice, one 64 bit word per site; each
+// lane still draws its own uniform number for every flip it cannot accept outright and starts from the lattice its
+// own run would, so the lanes are independent chains and the repetitions give the error bars of the sweep
+
+#define BATCH_LANES 64 // repetitions run in one batch
+#define BATCH_PLANES 33 // bits of a count of up to 2^32 sites
+
+// one lane of a batch: the run it stands for and where its results go
+typedef struct{
+    const parameters *p;
+    double *avg;
+    double *standard_deviation;
+    analysis *result;
+    counts *events;
+    telemetry *status;
+} lane;
+
+
+size_t BatchBytes( const parameters *p, int lanes );
+void BatchThresholds( const parameters *p, uint64_t threshold[] );
+INLINE void LaneCount( uint64_t planes[], uint64_t x );
+void BatchCorrelation( const parameters *p, const uint64_t sigma[], int lanes, stats statistics[] );
+void Run_Batch( lane lanes[], int number, int bins_number );
+
+
+size_t BatchBytes( const parameters *p, int lanes ){
+    // return the arena size needed by a batch: the bit-sliced lattice, the lattice a lane starts from and the
+    // correlation data of every lane
+    return ArenaSize( p->n*sizeof(uint64_t) ) + ArenaSize( p->n*sizeof(spin) ) + lanes*3*ArenaSize( p->separation*sizeof(double) );
+}
+
+void BatchThresholds( const parameters *p, uint64_t threshold[] ){
+    // acceptance probability of a flip with a aligned neighbours (h = 2*a-2*dim) as a fraction of 2^64
+    double boltzmann[4*MAX_DIM+1];
+    BoltzmannTable( p, boltzmann );
+    for ( int a=0; a<=2*p->dim; a++ ){
+        threshold[a] = boltzmann[2*a] >= 1 ? UINT64_MAX : (uint64_t)ldexp( boltzmann[2*a], 64 );
+    }
+}
+
+INLINE void LaneCount( uint64_t planes[], uint64_t x ){
+    // add one bit per lane to the bit-sliced counters, bit b of the count of lane l being bit l of planes[b]
+    for ( int b=0; x!=0; b++ ){
+        uint64_t carry = planes[b] & x;
+        planes[b] ^= x;
+        x = carry;
+    }
+}
+
+void BatchCorrelation( const parameters *p, const uint64_t sigma[], int lanes, stats statistics[] ){
+    // add the correlation along x of every lane to the bin of its statistics: sigma(x)*sigma(x+d) is 1 less twice
+    // the differing bit of the two sites, counted for all lanes at once
+    int size = p->size;
+    double norm = (double)p->n*p->bins_size;
+    for ( int d=0; d<p->separation; d++ ){
+        uint64_t planes[BATCH_PLANES] = { 0 };
+        int shift = d%size;
+        for ( long start=0; start<p->n; start+=size ){
+            for ( int x=0; x<size; x++ ){
+                LaneCount( planes, sigma[start+x] ^ sigma[start + (x+shift < size ? x+shift : x+shift-size)] );
+            }
+        }
+        for ( int l=0; l<lanes; l++ ){
+            long differ = 0;
+            for ( int b=0; b<BATCH_PLANES; b++ ){
+                differ |= (long)((planes[b] >> l) & 1) << b;
+            }
+            statistics[l].bin[d] += (p->n-2*differ)/norm;
+        }
+    }
+}
+
+void Run_Batch( lane lanes[], int number, int bins_number ){
+    // run the metropolis algorithm in the update order of the first lane in the number lanes of one bit-sliced
+    // lattice and find the avg. and s.d. of each lane; the acceptance numbers are drawn from stream 1 of the first
+    // lane's job, the cpu time is shared evenly and the hardware events all go to the first lane
+    const parameters *p = lanes[0].p;
+    double start = CpuSeconds();
+    for ( int l=0; l<number; l++ ){
+        CountsClear( lanes[l].events );
+        lanes[l].result->cpu_seconds = NAN;
+        for ( int o=0; o<OBSERVABLES; o++ ){
+            lanes[l].result->observables[o] = (autocorrelation){ NAN, NAN, NAN, 0, NAN, NAN };
+        }
+        if ( !p->telemetry ){
+            lanes[l].status = NULL;
+        }
+    }
+    if ( RunTables( p ) ){
+        printf( "Cannot map the order table of a %dD lattice of size %d\n", p->dim, p->size );
+        for ( int l=0; l<number; l++ ){
+            RunFailed( lanes[l].p, lanes[l].avg, lanes[l].standard_deviation );
+        }
+        return;
+    }
+    arena memory;
+    if ( ArenaInit( &memory, BatchBytes( p, number ), p->pages ) ){
+        printf( "Cannot allocate %zu bytes for a batch of %dD lattices of size %d\n", BatchBytes( p, number ), p->dim, p->size );
+        for ( int l=0; l<number; l++ ){
+            RunFailed( lanes[l].p, lanes[l].avg, lanes[l].standard_deviation );
+        }
+        return;
+    }
+
+    // each lane starts from the lattice of its own run
+    uint64_t *sigma = ArenaAlloc( &memory, p->n*sizeof(uint64_t) );
+    spin *initial = ArenaAlloc( &memory, p->n*sizeof(spin) );
+    memset( sigma, 0, p->n*sizeof(uint64_t) );
+    for ( int l=0; l<number; l++ ){
+        rng r;
+        RandomStream( &r, p->seed, StreamId( lanes[l].p->job, 0 ) );
+        InitialiseSigma( p, initial, &r );
+        for ( long i=0; i<p->n; i++ ){
+            sigma[i] |= (uint64_t)(initial[i] > 0) << l;
+        }
+    }
+    rng r;
+    RandomStream( &r, p->seed, StreamId( p->job, 1 ) );
+    uint64_t active = number == BATCH_LANES ? UINT64_MAX : ((uint64_t)1 << number) - 1;
+
+    stats statistics[number];
+    for ( int l=0; l<number; l++ ){
+        char spill[FILENAME_MAX];
+        if ( p->spill != NULL ){
+            snprintf( spill, sizeof(spill), "%s_%ld.csv", p->spill, lanes[l].p->job );
+        }
+        if ( StatsInit( &statistics[l], p->separation, &memory, p->spill != NULL ? spill : NULL, -1, p->binary, lanes[l].p->bins_offset ) ){
+            for ( int k=0; k<number; k++ ){
+                RunFailed( lanes[k].p, lanes[k].avg, lanes[k].standard_deviation );
+            }
+            for ( int k=0; k<=l; k++ ){
+                StatsFree( &statistics[k] );
+            }
+            ArenaFree( &memory );
+            return;
+        }
+    }
+
+    uint64_t threshold[2*MAX_DIM+1];
+    BatchThresholds( p, threshold );
+    int extent[MAX_DIM] = { p->size, p->size, p->size };
+    const uint32_t *table = OrderTable( p->order, LAYOUT_ROW, p->dim, extent );
+    batch_sweep_function sweep = FindKernel( p->dim, p->size ).batch;
+
+    counters count;
+    CountersOpen( &count, p->counters || p->telemetry, p->counters );
+    for ( int a=0; a<bins_number; a++ ){
+        for ( int b=0; b<p->bins_size; b++ ){
+            CountersPhase( &count, PHASE_SWEEP );
+            long accepted = sweep( sigma, table, threshold, active, &r, p->dim, p->size );
+            CountersPhase( &count, PHASE_MEASURE );
+            for ( int l=0; l<number; l++ ){
+                TelemetrySweep( lanes[l].status, 1, accepted/number, &count );
+            }
+            BatchCorrelation( p, sigma, number, statistics );
+        }
+        CountersPhase( &count, PHASE_REDUCE );
+        for ( int l=0; l<number; l++ ){
+            StatsCloseBin( &statistics[l] );
+            TelemetryBin( lanes[l].status, a+1 );
+        }
+    }
+
+    CountersPhase( &count, PHASE_REDUCE );
+    double seconds = (CpuSeconds()-start)/number;
+    for ( int l=0; l<number; l++ ){
+        StatsResult( &statistics[l], lanes[l].avg, lanes[l].standard_deviation );
+        StatsFree( &statistics[l] );
+        lanes[l].result->cpu_seconds = seconds;
+    }
+    CountersClose( &count );
+    *lanes[0].events = count.total;
+    lanes[0].events->updates = (double)bins_number*p->bins_size*p->n*number;
+    ArenaFree( &memory );
+}
@@ -0,0 +1,436 @@
+// the header files IMND_* need to be in the same directory as this file
+// benchmark of the parts of the ND engine: the sweep of every update order (and storage layout), the correlation
+// measurements and the building of the update order tables, for 1D, 2D and 3D lattices from in-L1 to far beyond
+// the last level cache; one csv row per case (site updates per ns, measurements per second) to catch regressions
+// and pick the fastest configuration of a machine
+// compile with: gcc -O2 IMND_Bench.c -o IMND_Bench -lm -pthread
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+// random numbers, memory, statistics, autocorrelation, checkpoints, hardware counters, telemetry, replica exchange,
+// fft, update orders, constants and functions, batches of repetitions, parameter sweeps
+#include "IMND_Random.h"
+#include "IMND_Arena.h"
+#include "IMND_Stats.h"
+#include "IMND_Autocorr.h"
+#include "IMND_Checkpoint.h"
+#include "IMND_Counters.h"
+#include "IMND_Telemetry.h"
+#include "IMND_Tempering.h"
+#include "IMND_FFT.h"
+#include "IMND_Orders.h"
+#include "IMND_Functions.h"
+#include "IMND_Batch.h"
+#include "IMND_Schedule.h"
+
+#define BENCH_SIZES 5 // lattice sizes of each dimension when none are given
+
+// default sizes: 2^10 to 2^26 sites (2^24 in 3D), 1 kB of spins to far beyond the last level cache
+const int BENCH_DEFAULT_SIZES[MAX_DIM+1][BENCH_SIZES] = {
+    { 0, 0, 0, 0, 0 },
+    { 1024, 16384, 262144, 4194304, 67108864 },
+    { 32, 128, 512, 2048, 8192 },
+    { 8, 32, 64, 128, 256 }
+};
+
+// everything a timed case works on
+typedef struct{
+    parameters *p;
+    spin *sigma;
+    double boltzmann[4*MAX_DIM+1];
+    rng r;
+    rng *streams; // random number streams of the layers for the checkerboard order
+    kernel k;
+    const uint32_t *table;
+    const uint32_t *neighbours; // neighbour table of the Hilbert layout
+    layout_sweep_function layout_sweep;
+    halo pad; // padding of the halo layout
+    spin *padded; // lattice of the halo layout
+    long *sums; // correlation sums of the incremental measurement, or NULL
+    fft_plan fft;
+    double *bin;
+    uint32_t *order_table; // table filled by BuildOrder
+    uint32_t *stack; // cluster of the Wolff algorithm, union-find forest of the Swendsen-Wang algorithm
+    spin *flip; // flips of the Swendsen-Wang clusters
+    long clusters; // Wolff clusters per sweep
+    uint64_t *lanes; // bit-sliced lattice of a batch of 64 repetitions
+    uint64_t threshold[2*MAX_DIM+1];
+    nfold fold; // classes of the n-fold way
+    slab task; // the single thread of a temporal block of the checkerboard order
+    signed char *field; // neighbour sum of every site
+    int order;
+} bench;
+
+typedef void (*bench_function)( bench *b );
+
+
+void Bench_Sweep( bench *b );
+void Bench_LayoutSweep( bench *b );
+void Bench_HaloSweep( bench *b );
+void Bench_Checkerboard( bench *b );
+void Bench_Block( bench *b );
+void Bench_Cluster( bench *b );
+void Bench_SwendsenWang( bench *b );
+void Bench_Batch( bench *b );
+void Bench_NFold( bench *b );
+void Bench_FieldSweep( bench *b );
+void Bench_Correlation( bench *b );
+void Bench_CorrelationFFT( bench *b );
+void Bench_CorrelationHalo( bench *b );
+void Bench_BuildOrder( bench *b );
+long Time( bench_function f, bench *b, double min_time, double *seconds );
+void BenchRow( FILE *fptr, const char *kind, const parameters *p, const char *measure, long repetitions, double seconds );
+void BenchLattice( FILE *fptr, parameters *p, const grid *g, double min_time );
+
+
+void Bench_Sweep( bench *b ){
+    // one sweep of a row-major lattice
+    sweep_function sweep = b->order == ORDER_RANDOM ? b->k.random : b->k.table;
+    sweep( b->sigma, b->table, b->boltzmann, &b->r, b->sums, b->p->separation, b->p->dim, b->p->size );
+}
+
+void Bench_LayoutSweep( bench *b ){
+    // one sweep of a lattice stored along a curve
+    b->layout_sweep( b->sigma, b->table, b->neighbours, b->boltzmann, &b->r, b->order == ORDER_RANDOM, b->p->dim, b->p->size );
+}
+
+void Bench_HaloSweep( bench *b ){
+    // one sweep of a lattice with halos
+    b->k.halo( b->padded, b->table, &b->pad, b->boltzmann, &b->r, b->order == ORDER_RANDOM, b->p->dim, b->p->size );
+}
+
+void Bench_Checkerboard( bench *b ){
+    // one sweep in checkerboard order by a single thread
+    for ( int parity=0; parity<2; parity++ ){
+        b->k.half( b->sigma, 0, b->p->size, parity, b->boltzmann, b->streams, b->p->dim, b->p->size );
+    }
+}
+
+void Bench_Block( bench *b ){
+    // one temporal block of the checkerboard order by a single thread, its sweeps measured layer by layer
+    memset( b->task.partial, 0, (size_t)b->task.depth*b->p->separation*sizeof(long) );
+    Slab_Block( &b->task, b->task.depth, b->task.partial );
+}
+
+void Bench_Cluster( bench *b ){
+    // one sweep of Wolff clusters
+    b->k.cluster( b->sigma, b->stack, b->boltzmann, &b->r, b->sums, b->p->separation, b->clusters, b->p->dim, b->p->size );
+}
+
+void Bench_SwendsenWang( bench *b ){
+    // one sweep of Swendsen-Wang clusters by a single thread
+    const parameters *p = b->p;
+    b->k.bonds( b->sigma, b->stack, 0, p->size, b->boltzmann, b->streams, p->dim, p->size );
+    ClusterLabel( b->stack, b->flip, 0, p->size, b->streams, p->dim, p->size );
+    ClusterFlip( b->sigma, b->stack, b->flip, 0, p->size, p->dim, p->size );
+}
+
+void Bench_Batch( bench *b ){
+    // one sweep of a batch of 64 repetitions
+    b->k.batch( b->lanes, b->table, b->threshold, UINT64_MAX, &b->r, b->p->dim, b->p->size );
+}
+
+void Bench_NFold( bench *b ){
+    // one sweep of the n-fold way
+    b->k.nfold( b->sigma, &b->fold, b->boltzmann, &b->r, b->sums, b->p->separation, b->p->dim, b->p->size );
+}
+
+void Bench_FieldSweep( bench *b ){
+    // one sweep of a row-major lattice with the neighbour sums kept in the field
+    b->k.field( b->sigma, b->field, b->table, b->boltzmann, &b->r, NULL, b->p->separation, b->order == ORDER_RANDOM, b->p->dim, b->p->size );
+}
+
+void Bench_Correlation( bench *b ){
+    // one direct measurement of the correlation
+    Correlation( b->p, b->sigma, b->bin );
+}
+
+void Bench_CorrelationFFT( bench *b ){
+    // one measurement of the correlation by fft
+    Correlation_FFT( b->p, b->sigma, &b->fft, b->bin );
+}
+
+void Bench_CorrelationHalo( bench *b ){
+    // one direct measurement of the correlation of a lattice with halos
+    Correlation_Halo( b->p, &b->pad, b->padded, b->bin );
+}
+
+void Bench_BuildOrder( bench *b ){
+    // build the table of one update order
+    int extent[MAX_DIM] = { b->p->size, b->p->size, b->p->size };
+    BuildOrder( b->order, b->p->dim, extent, b->order_table );
+}
+
+long Time( bench_function f, bench *b, double min_time, double *seconds ){
+    // run f once to warm up, then repeat it until min_time has passed; return the repetitions and their time
+    f( b );
+    long repetitions = 0;
+    double start = WallSeconds();
+    do{
+        f( b );
+        repetitions++;
+        *seconds = WallSeconds()-start;
+    } while ( *seconds < min_time );
+    return repetitions;
+}
+
+void BenchRow( FILE *fptr, const char *kind, const parameters *p, const char *measure, long repetitions, double seconds ){
+    // write the result of one case to the csv file and the screen
+    double per_second = repetitions/seconds;
+    double sites_per_ns = per_second*p->n*1e-9;
+    fprintf( fptr, "%s,%d,%d,%ld,%.4f,%s,%s,%s,%ld,%lf,%lf,%lf\n", kind, p->dim, p->size, p->n, p->beta, ORDER_NAMES[p->order],
+             LAYOUT_NAMES[p->layout], measure, repetitions, seconds, per_second, sites_per_ns );
+    fflush( fptr );
+    printf( "%-12s %dD size %-9d %-12s %-7s %-11s %12.1f /s %8.3f sites/ns\n", kind, p->dim, p->size, ORDER_NAMES[p->order],
+            LAYOUT_NAMES[p->layout], measure, per_second, sites_per_ns );
+}
+
+void BenchLattice( FILE *fptr, parameters *p, const grid *g, double min_time ){
+    // time the sweeps of all update orders, the measurements and the order tables of one lattice
+    int separation = g->base.separation;
+    int fft_separation = p->size/2+1;
+    p->order = ORDER_CHECKERBOARD;
+    p->measure = MEASURE_FFT;
+    p->separation = separation > fft_separation ? separation : fft_separation;
+    size_t bytes = JobBytes( p, 1 ) + 2*ArenaSize( p->n*sizeof(uint32_t) ) + ArenaSize( p->n*sizeof(spin) ) + ArenaSize( p->n*sizeof(uint64_t) );
+    bytes += 2*ArenaSize( p->n*sizeof(uint32_t) ) + 2*ArenaSize( p->n ) + ArenaSize( (size_t)p->block*p->separation*sizeof(long) );
+    arena memory;
+    if ( ArenaInit( &memory, bytes, p->pages ) ){
+        printf( "Cannot allocate %zu bytes for a %dD lattice of size %d\n", bytes, p->dim, p->size );
+        return;
+    }
+
+    bench b;
+    b.p = p;
+    RandomStream( &b.r, p->seed, StreamId( 0, 0 ) );
+    b.sigma = ArenaAlloc( &memory, p->n*sizeof(spin) );
+    InitialiseSigma( p, b.sigma, &b.r );
+    BoltzmannTable( p, b.boltzmann );
+    b.streams = ArenaAlloc( &memory, p->size*sizeof(rng) );
+    for ( int layer=0; layer<p->size; layer++ ){
+        RandomStream( &b.streams[layer], p->seed, StreamId( 0, 1+layer ) );
+    }
+    b.k = FindKernel( p->dim, p->size );
+    long *sums = ArenaAlloc( &memory, p->separation*sizeof(long) );
+    b.bin = ArenaAlloc( &memory, p->separation*sizeof(double) );
+    b.order_table = ArenaAlloc( &memory, p->n*sizeof(uint32_t) );
+    b.stack = ArenaAlloc( &memory, p->n*sizeof(uint32_t) );
+    b.flip = ArenaAlloc( &memory, p->n*sizeof(spin) );
+    FFTInit( &b.fft, p->dim, p->size, &memory );
+    b.lanes = ArenaAlloc( &memory, p->n*sizeof(uint64_t) );
+    for ( long i=0; i<p->n; i++ ){
+        b.lanes[i] = (uint64_t)Random32( &b.r ) << 32 | Random32( &b.r );
+    }
+    BatchThresholds( p, b.threshold );
+    b.fold.sites = ArenaAlloc( &memory, p->n*sizeof(uint32_t) );
+    b.fold.position = ArenaAlloc( &memory, p->n*sizeof(uint32_t) );
+    b.fold.aligned = ArenaAlloc( &memory, p->n );
+    b.field = ArenaAlloc( &memory, p->n );
+    uint32_t *neighbours = p->layout == LAYOUT_HILBERT ? ArenaAlloc( &memory, p->n*2*p->dim*sizeof(uint32_t) ) : NULL;
+    uint32_t *halo_table = NULL;
+    long *block_sums = ArenaAlloc( &memory, (size_t)p->block*separation*sizeof(long) );
+    if ( p->layout == LAYOUT_HALO ){
+        b.padded = ArenaAlloc( &memory, HaloSites( p->dim, p->size, p->separation )*sizeof(spin) );
+        halo_table = ArenaAlloc( &memory, p->n*sizeof(uint32_t) );
+        HaloInit( &b.pad, p->dim, p->size, separation );
+        HaloFill( &b.pad, b.sigma, b.padded, p->dim, p->size );
+    }
+    int extent[MAX_DIM] = { p->size, p->size, p->size };
+    double seconds;
+    long repetitions;
+
+    // sweeps of every update order, in the row layout also keeping the incremental correlation sums
+    p->separation = separation;
+    for ( int order=0; order<ORDERS; order++ ){
+        int chosen = g->orders_number == 0;
+        for ( int o=0; o<g->orders_number; o++ ){
+            chosen |= g->orders[o] == order;
+        }
+        if ( !chosen || !OrderSupported( order, p->dim, p->size ) || !LayoutSupported( p->layout, order, p->dim, p->size ) ){
+            continue;
+        }
+        p->order = order;
+        b.order = order;
+        if ( RunTables( p ) ){
+            printf( "Cannot map the order table of %s for a %dD lattice of size %d\n", ORDER_NAMES[order], p->dim, p->size );
+            continue;
+        }
+        if ( order == ORDER_CHECKERBOARD ){
+            repetitions = Time( Bench_Checkerboard, &b, min_time, &seconds );
+            BenchRow( fptr, "sweep", p, "none", repetitions, seconds );
+            int depth = p->block < (p->size-1)/4 ? p->block : (p->size-1)/4;
+            if ( depth > 1 && p->dim > 1 ){
+                pthread_barrier_t barrier;
+                pthread_barrier_init( &barrier, NULL, 1 );
+                b.task = (slab){ .id = 0, .first = 0, .last = p->size, .threads = 1, .depth = depth, .p = p, .boltzmann = b.boltzmann,
+                                 .k = b.k, .streams = b.streams, .sigma = b.sigma, .partial = block_sums, .barrier = &barrier };
+                repetitions = Time( Bench_Block, &b, min_time, &seconds );
+                BenchRow( fptr, "block_sweep", p, "direct", repetitions*depth, seconds );
+                pthread_barrier_destroy( &barrier );
+            }
+        }
+        else if ( order == ORDER_SWENDSEN_WANG ){
+            for ( long s=0; s<p->n; s++ ){
+                b.stack[s] = s;
+            }
+            repetitions = Time( Bench_SwendsenWang, &b, min_time, &seconds );
+            BenchRow( fptr, "sweep", p, "none", repetitions, seconds );
+        }
+        else if ( p->layout == LAYOUT_ROW ){
+            bench_function sweep = order == ORDER_WOLFF ? Bench_Cluster : order == ORDER_NFOLD ? Bench_NFold : Bench_Sweep;
+            b.table = OrderTable( order, LAYOUT_ROW, p->dim, extent );
+            b.sums = NULL;
+            if ( order == ORDER_WOLFF ){
+                b.clusters = WolffClusters( b.k.cluster, b.sigma, b.stack, b.boltzmann, &b.r, NULL, p->separation, p->dim, p->size );
+            }
+            if ( order == ORDER_NFOLD ){
+                NFoldInit( &b.fold, b.sigma, p->dim, p->size, 0 );
+            }
+            repetitions = Time( sweep, &b, min_time, &seconds );
+            BenchRow( fptr, "sweep", p, "none", repetitions, seconds );
+            b.sums = sums;
+            CorrelationSums_Axes( p, b.sigma, 0, p->size, b.sums );
+            repetitions = Time( sweep, &b, min_time, &seconds );
+            BenchRow( fptr, "sweep", p, "incremental", repetitions, seconds );
+            if ( !AlgorithmOrder( order ) ){
+                FieldInit( b.field, b.sigma, p->dim, p->size );
+                repetitions = Time( Bench_FieldSweep, &b, min_time, &seconds );
+                BenchRow( fptr, "field_sweep", p, "none", repetitions, seconds );
+            }
+            if ( order != ORDER_RANDOM && !AlgorithmOrder( order ) ){
+                repetitions = Time( Bench_Batch, &b, min_time, &seconds );
+                BenchRow( fptr, "batch_sweep", p, "none", repetitions, seconds );
+            }
+        }
+        else if ( p->layout == LAYOUT_HALO ){
+            const uint32_t *row = OrderTable( order == ORDER_RANDOM ? ORDER_ORDER : order, LAYOUT_ROW, p->dim, extent );
+            for ( long c=0; c<p->n; c++ ){
+                halo_table[c] = HaloPosition( &b.pad, row[c], p->dim, p->size );
+            }
+            b.table = halo_table;
+            repetitions = Time( Bench_HaloSweep, &b, min_time, &seconds );
+            BenchRow( fptr, "sweep", p, "none", repetitions, seconds );
+        }
+        else{
+            b.table = OrderTable( order == ORDER_RANDOM ? ORDER_ORDER : order, p->layout, p->dim, extent );
+            b.layout_sweep = b.k.morton;
+            b.neighbours = NULL;
+            if ( p->layout == LAYOUT_HILBERT ){
+                NeighbourTable( p, OrderTable( LAYOUT_CURVE[p->layout], LAYOUT_ROW, p->dim, extent ),
+                                OrderTable( ORDER_ORDER, p->layout, p->dim, extent ), neighbours );
+                b.neighbours = neighbours;
+                b.layout_sweep = Sweep_Layout;
+            }
+            repetitions = Time( Bench_LayoutSweep, &b, min_time, &seconds );
+            BenchRow( fptr, "sweep", p, "none", repetitions, seconds );
+        }
+    }
+
+    // measurements of the correlation and tables of the update orders are of a row-major lattice, the direct
+    // measurement also of the lattice with halos
+    if ( p->layout == LAYOUT_HALO ){
+        p->order = ORDER_ORDER;
+        repetitions = Time( Bench_CorrelationHalo, &b, min_time, &seconds );
+        BenchRow( fptr, "correlation", p, "direct", repetitions, seconds );
+    }
+    p->layout = LAYOUT_ROW;
+    p->order = ORDER_ORDER;
+    repetitions = Time( Bench_Correlation, &b, min_time, &seconds );
+    BenchRow( fptr, "correlation", p, "direct", repetitions, seconds );
+    p->separation = fft_separation;
+    repetitions = Time( Bench_CorrelationFFT, &b, min_time, &seconds );
+    BenchRow( fptr, "correlation", p, "fft", repetitions, seconds );
+    p->separation = separation;
+    for ( int order=0; order<ORDERS; order++ ){
+        if ( !TableOrder( order ) || !OrderSupported( order, p->dim, p->size ) ){
+            continue;
+        }
+        p->order = order;
+        b.order = order;
+        repetitions = Time( Bench_BuildOrder, &b, min_time, &seconds );
+        BenchRow( fptr, "order_table", p, "none", repetitions, seconds );
+    }
+
+    FreeOrderTables();
+    ArenaFree( &memory );
+}
+
+int main( int argc, char *argv[] ){
+
+    // the defaults of the sweep, then --key value pairs: the lattices, orders, layout and pages of the sweep and
+    // --min-time, the shortest time of each case in seconds
+    grid g;
+    ParseGrid( 1, argv, &g );
+    g.betas[0] = 0.44;
+    snprintf( g.output, sizeof(g.output), "Bench_ND.csv" );
+    double min_time = 0.2;
+    int dims_given = 0, sizes_given = 0;
+    for ( int i=1; i<argc; i+=2 ){
+        if ( strncmp( argv[i], "--", 2 ) != 0 || i+1 == argc ){
+            printf( "Usage: IMND_Bench [--dims 1,2,3] [--sizes L,...] [--betas b,...] [--orders a,b,...]\n"
+                    "                  [--layout row|morton|hilbert] [--pages normal|transparent|explicit] [--min-time s]\n"
+                    "                  [--output file]\n" );
+            return 1;
+        }
+        if ( strcmp( argv[i], "--min-time" ) == 0 ){
+            min_time = atof( argv[i+1] );
+            continue;
+        }
+        dims_given |= strcmp( argv[i], "--dim" ) == 0 || strcmp( argv[i], "--dims" ) == 0;
+        sizes_given |= strcmp( argv[i], "--size" ) == 0 || strcmp( argv[i], "--sizes" ) == 0;
+        if ( SetArgument( &g, argv[i]+2, argv[i+1] ) ){
+            return 1;
+        }
+    }
+    if ( !dims_given ){
+        ParseList_Int( "1,2,3", g.dims, &g.dims_number );
+    }
+
+    FILE *fptr = fopen( g.output, "w" );
+    if ( fptr == NULL ){
+        printf( "Cannot open %s\n", g.output );
+        return 1;
+    }
+    fprintf( fptr, "kind,dim,size,sites,beta,order,layout,measure,repetitions,seconds,per_second,sites_per_ns\n" );
+
+    for ( int i=0; i<g.dims_number; i++ ){
+        int dim = g.dims[i];
+        int sizes_number = sizes_given ? g.sizes_number : BENCH_SIZES;
+        for ( int j=0; j<sizes_number; j++ ){
+            int size = sizes_given ? g.sizes[j] : BENCH_DEFAULT_SIZES[dim][j];
+            if ( dim < 1 || dim > MAX_DIM || size < 2 || Power( size, dim ) > UINT32_MAX ){
+                printf( "Cannot run a %dD lattice of size %d\n", dim, size );
+                continue;
+            }
+            for ( int k=0; k<g.betas_number; k++ ){
+                parameters p = g.base;
+                p.dim = dim;
+                p.size = size;
+                p.n = Power( size, dim );
+                p.bins_size = 1;
+                p.beta = g.betas[k];
+                BenchLattice( fptr, &p, &g, min_time );
+            }
+        }
+    }
+
+    fclose( fptr );
+    return 0;
+}
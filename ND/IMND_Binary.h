@@ -0,0 +1,172 @@
+// this file needs to be in the same directory as the main file
+// binary output of a sweep: a json header describing every array, then one column per run parameter and the flat
+// arrays of results and raw bins, each aligned to 64 bytes so ReadND.py can map them into numpy without a copy;
+// the space of every run is reserved up front and its bins are written in place as they close;
+// layout: "IMNDBIN1", uint64 offset of the data, uint64 length of the header, the json header, the data;
+// the offset of each array is counted from the start of the data
+
+#define BINARY_MAGIC "IMNDBIN1"
+#define BINARY_PREAMBLE 24 // magic and the two lengths
+#define BINARY_ORDER (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ ? '>' : '<')
+
+// columns of the binary output, one value per run; values_start and bins_start index the avg, sd and bins arrays
+enum{ COLUMN_DIM, COLUMN_SIZE, COLUMN_BETA, COLUMN_MCS, COLUMN_BINS_SIZE, COLUMN_ORDER, COLUMN_MEASURE, COLUMN_LAYOUT,
+      COLUMN_REPETITION, COLUMN_SEED, COLUMN_SEPARATION, COLUMN_BINS_NUMBER, COLUMN_VALUES_START, COLUMN_BINS_START,
+      COLUMNS };
+const char *COLUMN_NAMES[COLUMNS] = { "dim", "size", "beta", "mcs", "bins_size", "order", "measure", "layout", "repetition",
+                                      "seed", "separation", "bins_number", "values_start", "bins_start" };
+const char *COLUMN_TYPES[COLUMNS] = { "i4", "i4", "f8", "i4", "i4", "i4", "i4", "i4", "i4", "u8", "i4", "i4", "i8", "i8" };
+
+
+long ColumnsBytes( long jobs_number );
+void BinaryNames( FILE *fptr, const char *key, const char *names[], int number );
+void BinaryArray( FILE *fptr, const char *name, const char *type, long offset, long count );
+void BinaryField( const job *jb, int column, long values_start, long bins_start, FILE *fptr );
+FILE *BinaryOpen( const char *name, job jobs[], long jobs_number );
+void BinaryClose( FILE *fptr, job jobs[], long jobs_number );
+
+
+long ColumnsBytes( long jobs_number ){
+    // return the bytes taken by the columns of all runs, where the avg array starts
+    long bytes = 0;
+    for ( int c=0; c<COLUMNS; c++ ){
+        bytes += ArenaSize( jobs_number*(COLUMN_TYPES[c][1]-'0') );
+    }
+    return bytes;
+}
+
+void BinaryNames( FILE *fptr, const char *key, const char *names[], int number ){
+    // write the names of the codes of one column into the header
+    fprintf( fptr, "\"%s\": [", key );
+    for ( int k=0; k<number; k++ ){
+        fprintf( fptr, "%s\"%s\"", k == 0 ? "" : ", ", names[k] );
+    }
+    fprintf( fptr, "]" );
+}
+
+void BinaryArray( FILE *fptr, const char *name, const char *type, long offset, long count ){
+    // write the description of one array into the header
+    fprintf( fptr, ",\n  {\"name\": \"%s\", \"dtype\": \"%c%s\", \"offset\": %ld, \"count\": %ld}", name, BINARY_ORDER, type, offset, count );
+}
+
+void BinaryField( const job *jb, int column, long values_start, long bins_start, FILE *fptr ){
+    // write the value of one column of a run
+    const parameters *p = &jb->p;
+    int32_t i4 = 0;
+    switch ( column ){
+        case COLUMN_DIM: i4 = p->dim; break;
+        case COLUMN_SIZE: i4 = p->size; break;
+        case COLUMN_MCS: i4 = p->mcs; break;
+        case COLUMN_BINS_SIZE: i4 = p->bins_size; break;
+        case COLUMN_ORDER: i4 = p->order; break;
+        case COLUMN_MEASURE: i4 = p->measure; break;
+        case COLUMN_LAYOUT: i4 = p->layout; break;
+        case COLUMN_REPETITION: i4 = p->replica; break;
+        case COLUMN_SEPARATION: i4 = p->separation; break;
+        case COLUMN_BINS_NUMBER: i4 = jb->bins_number; break;
+        case COLUMN_BETA: fwrite( &p->beta, sizeof(double), 1, fptr ); return;
+        case COLUMN_SEED: fwrite( &p->seed, sizeof(uint64_t), 1, fptr ); return;
+        case COLUMN_VALUES_START: { int64_t i8 = values_start; fwrite( &i8, sizeof(i8), 1, fptr ); return; }
+        case COLUMN_BINS_START: { int64_t i8 = bins_start; fwrite( &i8, sizeof(i8), 1, fptr ); return; }
+    }
+    fwrite( &i4, sizeof(i4), 1, fptr );
+}
+
+FILE *BinaryOpen( const char *name, job jobs[], long jobs_number ){
+    // write the header and the columns of all runs, reserve the space of the results and bins and point every run
+    // at its bins; return the open file, or NULL
+    FILE *fptr = fopen( name, "w+b" );
+    if ( fptr == NULL ){
+        printf( "Cannot open %s\n", name );
+        return NULL;
+    }
+
+    long values = 0, bins = 0;
+    for ( long j=0; j<jobs_number; j++ ){
+        values += jobs[j].p.separation;
+        bins += (long)jobs[j].bins_number*jobs[j].p.separation;
+    }
+    long offsets[COLUMNS+3];
+    long offset = 0;
+    for ( int c=0; c<COLUMNS; c++ ){
+        offsets[c] = offset;
+        offset += ArenaSize( jobs_number*(COLUMN_TYPES[c][1]-'0') );
+    }
+    offsets[COLUMNS] = offset; // avg, at ColumnsBytes
+    offset += ArenaSize( values*sizeof(double) );
+    offsets[COLUMNS+1] = offset; // sd
+    offset += ArenaSize( values*sizeof(double) );
+    offsets[COLUMNS+2] = offset; // bins
+    offset += ArenaSize( bins*sizeof(double) );
+
+    fseek( fptr, BINARY_PREAMBLE, SEEK_SET );
+    fprintf( fptr, "{\"format\": \"imnd\", \"version\": 1, \"jobs\": %ld,\n ", jobs_number );
+    BinaryNames( fptr, "order", ORDER_NAMES, ORDERS );
+    fprintf( fptr, ",\n " );
+    BinaryNames( fptr, "measure", MEASURE_NAMES, MEASURES );
+    fprintf( fptr, ",\n " );
+    BinaryNames( fptr, "layout", LAYOUT_NAMES, LAYOUTS );
+    fprintf( fptr, ",\n \"arrays\": [\n  {\"name\": \"avg\", \"dtype\": \"%cf8\", \"offset\": %ld, \"count\": %ld}", BINARY_ORDER, offsets[COLUMNS], values );
+    BinaryArray( fptr, "sd", "f8", offsets[COLUMNS+1], values );
+    BinaryArray( fptr, "bins", "f8", offsets[COLUMNS+2], bins );
+    for ( int c=0; c<COLUMNS; c++ ){
+        BinaryArray( fptr, COLUMN_NAMES[c], COLUMN_TYPES[c], offsets[c], jobs_number );
+    }
+    fprintf( fptr, "\n ]}\n" );
+
+    uint64_t header = ftell( fptr )-BINARY_PREAMBLE;
+    uint64_t data = ArenaSize( BINARY_PREAMBLE+header );
+    fseek( fptr, 0, SEEK_SET );
+    fwrite( BINARY_MAGIC, 1, 8, fptr );
+    fwrite( &data, sizeof(data), 1, fptr );
+    fwrite( &header, sizeof(header), 1, fptr );
+
+    for ( int c=0; c<COLUMNS; c++ ){
+        fseek( fptr, data+offsets[c], SEEK_SET );
+        long values_start = 0, bins_start = 0;
+        for ( long j=0; j<jobs_number; j++ ){
+            BinaryField( &jobs[j], c, values_start, bins_start, fptr );
+            values_start += jobs[j].p.separation;
+            bins_start += (long)jobs[j].bins_number*jobs[j].p.separation;
+        }
+    }
+    fflush( fptr );
+    if ( ftruncate( fileno( fptr ), data+offset ) != 0 ){
+        printf( "Cannot reserve %ld bytes for %s\n", (long)data+offset, name );
+        fclose( fptr );
+        return NULL;
+    }
+
+    long bins_start = 0;
+    for ( long j=0; j<jobs_number; j++ ){
+        jobs[j].p.binary = fileno( fptr );
+        jobs[j].p.bins_offset = data+offsets[COLUMNS+2]+bins_start*sizeof(double);
+        bins_start += (long)jobs[j].bins_number*jobs[j].p.separation;
+    }
+    return fptr;
+}
+
+void BinaryClose( FILE *fptr, job jobs[], long jobs_number ){
+    // write the averages and standard deviations of all runs into their arrays and close the file
+    uint64_t data;
+    fseek( fptr, 8, SEEK_SET );
+    if ( fread( &data, sizeof(data), 1, fptr ) != 1 ){
+        fclose( fptr );
+        return;
+    }
+    long values = 0;
+    for ( long j=0; j<jobs_number; j++ ){
+        values += jobs[j].p.separation;
+    }
+    long avg = ColumnsBytes( jobs_number );
+
+    fseek( fptr, data+avg, SEEK_SET );
+    for ( long j=0; j<jobs_number; j++ ){
+        fwrite( jobs[j].avg, sizeof(double), jobs[j].p.separation, fptr );
+    }
+    fseek( fptr, data+avg+ArenaSize( values*sizeof(double) ), SEEK_SET );
+    for ( long j=0; j<jobs_number; j++ ){
+        fwrite( jobs[j].standard_deviation, sizeof(double), jobs[j].p.separation, fptr );
+    }
+    fclose( fptr );
+}
@@ -0,0 +1,196 @@
+// this file needs to be in the same directory as the main file
+// checkpoints of long chains: at the end of a bin the whole state of a run (lattice in row-major order, random
+// number streams, the classes of the n-fold way, running statistics, time series) is written to a temporary file that is then renamed over the
+// last checkpoint, so a killed run always leaves a complete one; a resumed run continues bit-identically and may
+// be extended to more sweeps
+
+#define CHECKPOINT_MAGIC "IMNDCKP3"
+
+// identity and position of a chain; a checkpoint only resumes the same chain
+typedef struct{
+    char magic[8];
+    int dim;
+    int size;
+    int order;
+    int measure;
+    int layout;
+    int bins_size;
+    int separation;
+    int replica;
+    int series; // 1 if the time series is recorded
+    int tempering; // sweeps between replica exchanges, 0 for an independent chain
+    long job;
+    uint64_t seed;
+    double beta;
+    long bins; // closed bins
+    long recorded; // sweeps in the time series
+    long spill_position; // length of the spill file, or -1
+    int streams; // random number streams of the layers
+    double cpu_seconds; // cpu time of the chain up to the checkpoint
+    long clusters; // Wolff clusters per sweep, fixed at the start of the chain
+} checkpoint_header;
+
+// checkpoints of one run and the state they hold
+typedef struct{
+    char name[FILENAME_MAX]; // empty if the run is not checkpointed
+    double every; // seconds between checkpoints
+    double last; // wall time of the last checkpoint
+    double start; // cpu time of the calling thread at the start of the run
+    double helpers; // cpu time of the other threads of the run up to the current bin
+    double resumed; // cpu time of the chain before the run
+    checkpoint_header header; // identity of the chain, filled in by the run
+    long n; // bytes of the lattice, one per site
+    const void *lattice; // the lattice in row-major order
+    rng *r;
+    rng *streams;
+    uint32_t *sites; // sites of the n-fold way in the order of their classes, or NULL
+    stats *statistics;
+    series *history;
+} checkpoint;
+
+
+double WallSeconds( void );
+int CheckpointMatch( const checkpoint_header *saved, const checkpoint_header *run );
+double ChainSeconds( const checkpoint *c );
+int CheckpointOpen( checkpoint *c, int resume, int bins_number );
+int CheckpointRead( checkpoint *c, void *lattice );
+void CheckpointWrite( checkpoint *c );
+int CheckpointDue( const checkpoint *c, int last );
+void CheckpointBin( checkpoint *c, int last );
+
+
+double WallSeconds( void ){
+    // return the time of a monotonic clock
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return now.tv_sec + 1e-9*now.tv_nsec;
+}
+
+double ChainSeconds( const checkpoint *c ){
+    // return the cpu time of the chain: before the run, of the calling thread and of the other threads
+    return c->resumed + CpuSeconds()-c->start + c->helpers;
+}
+
+int CheckpointMatch( const checkpoint_header *saved, const checkpoint_header *run ){
+    // return 1 if a saved chain is the chain of the run
+    return memcmp( saved->magic, CHECKPOINT_MAGIC, 8 ) == 0 && saved->dim == run->dim && saved->size == run->size &&
+           saved->order == run->order && saved->measure == run->measure && saved->layout == run->layout &&
+           saved->bins_size == run->bins_size && saved->separation == run->separation && saved->replica == run->replica &&
+           saved->series == run->series && saved->tempering == run->tempering && saved->job == run->job &&
+           saved->seed == run->seed && saved->beta == run->beta && saved->streams == run->streams;
+}
+
+int CheckpointOpen( checkpoint *c, int resume, int bins_number ){
+    // read the header of the checkpoint of a resumed run into c->header; return 0 to start from the beginning
+    // (also when there is no checkpoint yet), 1 to resume, -1 if the checkpoint is of another chain or has more
+    // bins than the run
+    memcpy( c->header.magic, CHECKPOINT_MAGIC, 8 );
+    c->last = WallSeconds();
+    c->helpers = 0;
+    c->resumed = 0;
+    c->header.bins = 0;
+    c->header.recorded = 0;
+    c->header.spill_position = -1;
+    c->header.cpu_seconds = 0;
+    c->header.clusters = 0;
+    if ( c->name[0] == 0 || !resume ){
+        return 0;
+    }
+    FILE *fptr = fopen( c->name, "rb" );
+    if ( fptr == NULL ){
+        return 0;
+    }
+    checkpoint_header saved;
+    int read = fread( &saved, sizeof(saved), 1, fptr );
+    fclose( fptr );
+    if ( read != 1 || !CheckpointMatch( &saved, &c->header ) ){
+        printf( "Checkpoint %s is not of this run\n", c->name );
+        return -1;
+    }
+    if ( saved.bins > bins_number ){
+        printf( "Checkpoint %s has %ld bins, more than the run\n", c->name, saved.bins );
+        return -1;
+    }
+    c->header = saved;
+    c->resumed = saved.cpu_seconds;
+    return 1;
+}
+
+int CheckpointRead( checkpoint *c, void *lattice ){
+    // read the state of a resumed run; return 1 on failure
+    FILE *fptr = fopen( c->name, "rb" );
+    if ( fptr == NULL ){
+        return 1;
+    }
+    checkpoint_header saved;
+    stats *s = c->statistics;
+    int failed = fread( &saved, sizeof(saved), 1, fptr ) != 1;
+    failed |= fread( lattice, 1, c->n, fptr ) != (size_t)c->n;
+    failed |= fread( c->r, sizeof(rng), 1, fptr ) != 1;
+    failed |= fread( c->streams, sizeof(rng), c->header.streams, fptr ) != (size_t)c->header.streams;
+    if ( c->sites != NULL ){
+        failed |= fread( c->sites, sizeof(uint32_t), c->n, fptr ) != (size_t)c->n;
+    }
+    failed |= fread( s->mean, sizeof(double), s->separation, fptr ) != (size_t)s->separation;
+    failed |= fread( s->m2, sizeof(double), s->separation, fptr ) != (size_t)s->separation;
+    for ( int o=0; o<OBSERVABLES && c->header.series; o++ ){
+        failed |= fread( c->history->values[o], sizeof(double), c->header.recorded, fptr ) != (size_t)c->header.recorded;
+    }
+    fclose( fptr );
+    s->bins = c->header.bins;
+    c->history->recorded = c->header.recorded;
+    if ( failed ){
+        printf( "Checkpoint %s is incomplete\n", c->name );
+    }
+    return failed;
+}
+
+void CheckpointWrite( checkpoint *c ){
+    // write the state of the run at the end of a bin to name.tmp and rename it over the last checkpoint
+    char temporary[FILENAME_MAX+4];
+    snprintf( temporary, sizeof(temporary), "%s.tmp", c->name );
+    FILE *fptr = fopen( temporary, "wb" );
+    if ( fptr == NULL ){
+        printf( "Cannot open %s\n", temporary );
+        return;
+    }
+    stats *s = c->statistics;
+    if ( s->spill != NULL ){
+        fflush( s->spill );
+    }
+    c->header.bins = s->bins;
+    c->header.recorded = c->history->recorded;
+    c->header.spill_position = s->spill != NULL ? ftell( s->spill ) : -1;
+    c->header.cpu_seconds = ChainSeconds( c );
+
+    fwrite( &c->header, sizeof(c->header), 1, fptr );
+    fwrite( c->lattice, 1, c->n, fptr );
+    fwrite( c->r, sizeof(rng), 1, fptr );
+    fwrite( c->streams, sizeof(rng), c->header.streams, fptr );
+    if ( c->sites != NULL ){
+        fwrite( c->sites, sizeof(uint32_t), c->n, fptr );
+    }
+    fwrite( s->mean, sizeof(double), s->separation, fptr );
+    fwrite( s->m2, sizeof(double), s->separation, fptr );
+    for ( int o=0; o<OBSERVABLES && c->header.series; o++ ){
+        fwrite( c->history->values[o], sizeof(double), c->history->recorded, fptr );
+    }
+    int failed = fflush( fptr ) != 0 || fsync( fileno( fptr ) ) != 0;
+    failed |= fclose( fptr ) != 0;
+    if ( failed || rename( temporary, c->name ) != 0 ){
+        printf( "Cannot write checkpoint %s\n", c->name );
+    }
+    c->last = WallSeconds();
+}
+
+int CheckpointDue( const checkpoint *c, int last ){
+    // return 1 after the last bin of the run or when the interval has passed since the last checkpoint
+    return c->name[0] != 0 && (last || WallSeconds()-c->last >= c->every);
+}
+
+void CheckpointBin( checkpoint *c, int last ){
+    // write a checkpoint when one is due
+    if ( CheckpointDue( c, last ) ){
+        CheckpointWrite( c );
+    }
+}
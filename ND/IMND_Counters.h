@@ -0,0 +1,164 @@
+// this file needs to be in the same directory as the main file
+// hardware performance counters (perf_event_open, Linux): cycles, instructions, L1 data and last level cache misses
+// and branch misses of the sweep, measurement and reduction phases of a run, counted per thread in user space and
+// summed over the threads of the run; counters the machine or its permissions do not allow are left out
+
+// counted events, the names are used in the json output
+enum{ COUNTER_CYCLES, COUNTER_INSTRUCTIONS, COUNTER_L1D_MISSES, COUNTER_LLC_MISSES, COUNTER_BRANCH_MISSES, COUNTERS };
+const char *COUNTER_NAMES[COUNTERS] = { "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses" };
+
+// phases of a run: sweeps, correlation and observable measurements, combining partial sums and closing bins
+enum{ PHASE_SWEEP, PHASE_MEASURE, PHASE_REDUCE, PHASES };
+const char *PHASE_NAMES[PHASES] = { "sweep", "measure", "reduce" };
+
+// counts of one run, per phase and summed over its threads
+typedef struct{
+    double updates; // site updates of the run
+    int available; // bit c is set if counter c could be opened
+    double value[PHASES][COUNTERS]; // scaled up if the counters were multiplexed
+    double seconds[PHASES]; // thread-seconds
+} counts;
+
+// open counters of one thread
+typedef struct{
+    int enabled; // 0 if the run is neither timed nor counted, then switching phases does nothing
+    int fd[COUNTERS]; // -1 if not open
+    int leader; // fd of the group leader, -1 if no counter is open
+    int index[COUNTERS]; // position of each counter in a group read
+    int open;
+    int phase; // phase being counted, -1 before the first
+    double last[COUNTERS]; // scaled values at the last switch
+    double since; // wall time of the last switch
+    counts total;
+} counters;
+
+
+void CountsClear( counts *c );
+void CountsAdd( counts *sum, const counts *c );
+void CountersOpen( counters *c, int timed, int events );
+void CountersRead( const counters *c, double values[] );
+void CountersPhase( counters *c, int phase );
+void CountersClose( counters *c );
+
+
+void CountsClear( counts *c ){
+    // zero the counts of a run
+    memset( c, 0, sizeof(counts) );
+}
+
+void CountsAdd( counts *sum, const counts *c ){
+    // add the counts of one thread to those of the run; the site updates are those of the run already
+    sum->available |= c->available;
+    for ( int phase=0; phase<PHASES; phase++ ){
+        for ( int k=0; k<COUNTERS; k++ ){
+            sum->value[phase][k] += c->value[phase][k];
+        }
+        sum->seconds[phase] += c->seconds[phase];
+    }
+}
+
+void CountersOpen( counters *c, int timed, int events ){
+    // open the counters of the calling thread as one group and start them if the events are counted; only the
+    // time of each phase is counted if they are not, or perf_event_open is not allowed, and nothing if not timed
+    c->enabled = timed || events;
+    c->leader = -1;
+    c->open = 0;
+    c->phase = -1;
+    CountsClear( &c->total );
+    for ( int k=0; k<COUNTERS; k++ ){
+        c->fd[k] = -1;
+        c->index[k] = -1;
+        c->last[k] = 0;
+    }
+    if ( !events ){
+        c->since = WallSeconds();
+        return;
+    }
+#ifdef __linux__
+    const uint32_t type[COUNTERS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE };
+    const uint64_t config[COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    for ( int k=0; k<COUNTERS; k++ ){
+        struct perf_event_attr attr;
+        memset( &attr, 0, sizeof(attr) );
+        attr.size = sizeof(attr);
+        attr.type = type[k];
+        attr.config = config[k];
+        attr.disabled = c->leader < 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        c->fd[k] = syscall( SYS_perf_event_open, &attr, 0, -1, c->leader, 0 );
+        if ( c->fd[k] < 0 ){
+            c->fd[k] = -1;
+            continue;
+        }
+        if ( c->leader < 0 ){
+            c->leader = c->fd[k];
+        }
+        c->index[k] = c->open++;
+        c->total.available |= 1 << k;
+    }
+    if ( c->leader >= 0 ){
+        ioctl( c->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+        ioctl( c->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+    }
+#endif
+    c->since = WallSeconds();
+}
+
+void CountersRead( const counters *c, double values[] ){
+    // read the group, scaled up by enabled/running time if the counters were multiplexed
+    uint64_t data[3+COUNTERS]; // number of counters, time enabled, time running, values
+    for ( int k=0; k<COUNTERS; k++ ){
+        values[k] = 0;
+    }
+    if ( c->leader < 0 || read( c->leader, data, sizeof(data) ) < (ssize_t)(3*sizeof(uint64_t)) ){
+        return;
+    }
+    double scale = data[2] > 0 ? (double)data[1]/data[2] : 0;
+    for ( int k=0; k<COUNTERS; k++ ){
+        if ( c->index[k] >= 0 ){
+            values[k] = data[3+c->index[k]]*scale;
+        }
+    }
+}
+
+void CountersPhase( counters *c, int phase ){
+    // add the counts since the last switch to the phase being counted and count phase from now on
+    if ( !c->enabled ){
+        return;
+    }
+    double now = WallSeconds();
+    double values[COUNTERS];
+    CountersRead( c, values );
+    if ( c->phase >= 0 ){
+        for ( int k=0; k<COUNTERS; k++ ){
+            c->total.value[c->phase][k] += values[k]-c->last[k];
+        }
+        c->total.seconds[c->phase] += now-c->since;
+    }
+    for ( int k=0; k<COUNTERS; k++ ){
+        c->last[k] = values[k];
+    }
+    c->since = now;
+    c->phase = phase;
+}
+
+void CountersClose( counters *c ){
+    // count the last phase and close the counters
+    CountersPhase( c, -1 );
+    c->enabled = 0;
+    for ( int k=0; k<COUNTERS; k++ ){
+        if ( c->fd[k] >= 0 ){
+            close( c->fd[k] );
+            c->fd[k] = -1;
+        }
+    }
+    c->leader = -1;
+}
@@ -0,0 +1,216 @@
+// this file needs to be in the same directory as the main file
+// fast Fourier transform of the whole lattice, one axis at a time: radix-2 when the size is a power of 2,
+// otherwise Bluestein's chirp-z algorithm, which turns a line of any size into a circular convolution done
+// with radix-2 transforms of the next power of 2 at least 2*size-1
+
+// tables and work space of the transform of one lattice
+typedef struct{
+    int dim;
+    int size;
+    long n;
+    int radix2; // 1 if size is a power of 2
+    int length; // length of the radix-2 transforms: size, or the padded length of Bluestein's algorithm
+    double *twiddle_re; // exp(-2*pi*i*k/length) for k<length
+    double *twiddle_im;
+    int *reverse; // bit reversed index of each position of a radix-2 transform
+    double *re; // the lattice being transformed
+    double *im;
+    double *line_re; // one line of the lattice
+    double *line_im;
+    double *chirp_re; // exp(-i*pi*k^2/size) for k<size, Bluestein only
+    double *chirp_im;
+    double *filter_re; // transform of the conjugate chirp divided by length, Bluestein only
+    double *filter_im;
+    double *scratch_re; // padded line of length elements, Bluestein only
+    double *scratch_im;
+} fft_plan;
+
+
+int FFTLength( int size );
+size_t FFTBytes( int dim, int size );
+void FFTInit( fft_plan *f, int dim, int size, arena *memory );
+void FFTRadix2( const fft_plan *f, double re[], double im[], double sign );
+void FFTLine( const fft_plan *f, double re[], double im[], int inverse );
+void FFTLattice( fft_plan *f, int inverse );
+
+
+int FFTLength( int size ){
+    // return the length of the radix-2 transforms of a line: size itself if it is a power of 2, otherwise the
+    // smallest power of 2 that holds the linear convolution of Bluestein's algorithm
+    if ( (size & (size-1)) == 0 ){
+        return size;
+    }
+    int length = 1;
+    while ( length < 2*size-1 ){
+        length *= 2;
+    }
+    return length;
+}
+
+size_t FFTBytes( int dim, int size ){
+    // return the arena size taken by FFTInit
+    long n = 1;
+    for ( int axis=0; axis<dim; axis++ ){
+        n *= size;
+    }
+    int length = FFTLength( size );
+    size_t bytes = 2*ArenaSize( n*sizeof(double) ) + 2*ArenaSize( size*sizeof(double) );
+    bytes += 2*ArenaSize( length*sizeof(double) ) + ArenaSize( length*sizeof(int) );
+    if ( length != size ){
+        bytes += 2*ArenaSize( size*sizeof(double) ) + 4*ArenaSize( length*sizeof(double) );
+    }
+    return bytes;
+}
+
+void FFTInit( fft_plan *f, int dim, int size, arena *memory ){
+    // take the work space from the arena of the job and compute the twiddle factors and bit reversal of the
+    // radix-2 transforms, and for other sizes the chirp and the transform of its filter
+    f->dim = dim;
+    f->size = size;
+    f->n = 1;
+    for ( int axis=0; axis<dim; axis++ ){
+        f->n *= size;
+    }
+    f->radix2 = (size & (size-1)) == 0;
+    f->length = FFTLength( size );
+
+    int length = f->length;
+    f->twiddle_re = ArenaAlloc( memory, length*sizeof(double) );
+    f->twiddle_im = ArenaAlloc( memory, length*sizeof(double) );
+    f->reverse = ArenaAlloc( memory, length*sizeof(int) );
+    for ( int k=0; k<length; k++ ){
+        f->twiddle_re[k] = cos( 2*M_PI*k/length );
+        f->twiddle_im[k] = -sin( 2*M_PI*k/length );
+        int r = 0;
+        for ( int bit=1; bit<length; bit*=2 ){
+            r = 2*r + ((k & bit) != 0);
+        }
+        f->reverse[k] = r;
+    }
+
+    f->re = ArenaAlloc( memory, f->n*sizeof(double) );
+    f->im = ArenaAlloc( memory, f->n*sizeof(double) );
+    f->line_re = ArenaAlloc( memory, size*sizeof(double) );
+    f->line_im = ArenaAlloc( memory, size*sizeof(double) );
+    f->chirp_re = f->chirp_im = f->filter_re = f->filter_im = f->scratch_re = f->scratch_im = NULL;
+    if ( f->radix2 ){
+        return;
+    }
+
+    f->chirp_re = ArenaAlloc( memory, size*sizeof(double) );
+    f->chirp_im = ArenaAlloc( memory, size*sizeof(double) );
+    f->filter_re = ArenaAlloc( memory, length*sizeof(double) );
+    f->filter_im = ArenaAlloc( memory, length*sizeof(double) );
+    f->scratch_re = ArenaAlloc( memory, length*sizeof(double) );
+    f->scratch_im = ArenaAlloc( memory, length*sizeof(double) );
+    for ( int k=0; k<size; k++ ){
+        // k^2 is reduced mod 2*size before the division so the angle stays accurate for long lines
+        double angle = M_PI*(double)(((long)k*k) % (2*size))/size;
+        f->chirp_re[k] = cos( angle );
+        f->chirp_im[k] = -sin( angle );
+    }
+    for ( int k=0; k<length; k++ ){
+        f->filter_re[k] = 0;
+        f->filter_im[k] = 0;
+    }
+    for ( int k=0; k<size; k++ ){
+        f->filter_re[k] = f->chirp_re[k];
+        f->filter_im[k] = -f->chirp_im[k];
+        if ( k > 0 ){
+            f->filter_re[length-k] = f->chirp_re[k];
+            f->filter_im[length-k] = -f->chirp_im[k];
+        }
+    }
+    FFTRadix2( f, f->filter_re, f->filter_im, 1 );
+    for ( int k=0; k<length; k++ ){
+        f->filter_re[k] /= length;
+        f->filter_im[k] /= length;
+    }
+}
+
+void FFTRadix2( const fft_plan *f, double re[], double im[], double sign ){
+    // transform length elements in place; sign is 1 for the forward and -1 for the (undivided) inverse transform
+    int length = f->length;
+    for ( int k=0; k<length; k++ ){
+        int r = f->reverse[k];
+        if ( k < r ){
+            double t = re[k]; re[k] = re[r]; re[r] = t;
+            t = im[k]; im[k] = im[r]; im[r] = t;
+        }
+    }
+    for ( int span=2; span<=length; span*=2 ){
+        int half = span/2;
+        int step = length/span;
+        for ( int start=0; start<length; start+=span ){
+            for ( int k=0; k<half; k++ ){
+                double wr = f->twiddle_re[k*step], wi = sign*f->twiddle_im[k*step];
+                int u = start+k, v = start+k+half;
+                double vr = re[v]*wr - im[v]*wi;
+                double vi = re[v]*wi + im[v]*wr;
+                re[v] = re[u] - vr;
+                im[v] = im[u] - vi;
+                re[u] += vr;
+                im[u] += vi;
+            }
+        }
+    }
+}
+
+void FFTLine( const fft_plan *f, double re[], double im[], int inverse ){
+    // transform one line in place; the inverse transform is not divided by size
+    double sign = inverse ? -1 : 1;
+    if ( f->radix2 ){
+        FFTRadix2( f, re, im, sign );
+        return;
+    }
+
+    // Bluestein: with jk = (j^2 + k^2 - (k-j)^2)/2 the transform is the chirp times the circular convolution of
+    // the chirped line with the conjugate chirp; the inverse uses the conjugate of both
+    int size = f->size, length = f->length;
+    double *a_re = f->scratch_re, *a_im = f->scratch_im;
+    for ( int j=0; j<size; j++ ){
+        double cr = f->chirp_re[j], ci = sign*f->chirp_im[j];
+        a_re[j] = re[j]*cr - im[j]*ci;
+        a_im[j] = re[j]*ci + im[j]*cr;
+    }
+    for ( int j=size; j<length; j++ ){
+        a_re[j] = 0;
+        a_im[j] = 0;
+    }
+    FFTRadix2( f, a_re, a_im, 1 );
+    for ( int k=0; k<length; k++ ){
+        double br = f->filter_re[k], bi = sign*f->filter_im[k];
+        double t = a_re[k]*br - a_im[k]*bi;
+        a_im[k] = a_re[k]*bi + a_im[k]*br;
+        a_re[k] = t;
+    }
+    FFTRadix2( f, a_re, a_im, -1 );
+    for ( int k=0; k<size; k++ ){
+        double cr = f->chirp_re[k], ci = sign*f->chirp_im[k];
+        re[k] = a_re[k]*cr - a_im[k]*ci;
+        im[k] = a_re[k]*ci + a_im[k]*cr;
+    }
+}
+
+void FFTLattice( fft_plan *f, int inverse ){
+    // transform f->re + i*f->im along every axis; each line is copied out, transformed and copied back
+    int size = f->size;
+    long stride = 1;
+    for ( int axis=0; axis<f->dim; axis++ ){
+        for ( long block=0; block<f->n; block+=stride*size ){
+            for ( long offset=0; offset<stride; offset++ ){
+                long start = block+offset;
+                for ( int j=0; j<size; j++ ){
+                    f->line_re[j] = f->re[start+j*stride];
+                    f->line_im[j] = f->im[start+j*stride];
+                }
+                FFTLine( f, f->line_re, f->line_im, inverse );
+                for ( int j=0; j<size; j++ ){
+                    f->re[start+j*stride] = f->line_re[j];
+                    f->im[start+j*stride] = f->line_im[j];
+                }
+            }
+        }
+        stride *= size;
+    }
+}
@@ -0,0 +1,1711 @@
+// this file needs to be in the same directory as the main file
+// constants and functions to run the model in any dimension (1-3), lattice size and update order;
+// the sweep is written once as an inlined kernel and specialised for common dimensions and sizes
+
+#define INLINE static inline __attribute__((always_inline))
+#define WOLFF_CALIBRATION 10 // sweeps of Wolff clusters that fix the clusters per sweep of a run
+
+// ways of measuring the correlation: direct sums along x up to the separation, the fft of the whole lattice
+// for every separation up to size/2 averaged over the axes, or sums over all axes kept up to date by each flip
+enum{ MEASURE_DIRECT, MEASURE_FFT, MEASURE_INCREMENTAL, MEASURES };
+const char *MEASURE_NAMES[MEASURES] = { "direct", "fft", "incremental" };
+
+typedef signed char spin; // +/- 1
+
+// parameters of one run; site i has coordinates x = i%size, y = (i/size)%size, z = i/size^2
+typedef struct{
+    int dim; // dimension of the lattice
+    int size; // size of the lattice (total number of sites is size^dim)
+    long n; // total number of sites
+    int mcs; // total number of states to be generated
+    int bins_size; // size of bins to average over in order to smooth out fluctuations
+    int separation; // correlation will be calc. for separation of 0 to separation-1
+    int threads; // number of threads sharing the lattice in the checkerboard update order
+    int order; // update order
+    int measure; // way of measuring the correlation
+    int layout; // storage layout of the lattice
+    int pages; // pages backing the memory of the run
+    const char *spill; // prefix of the files the raw bins of each run are written to, or NULL
+    int binary; // descriptor of the binary output of the sweep, or -1
+    long bins_offset; // byte offset of the raw bins of the run in the binary output
+    int series; // 1 to record the observables after each sweep and find their autocorrelation time
+    int counters; // 1 to count the hardware events of the sweeps, measurements and reductions of the run
+    int telemetry; // 1 to publish the progress of the run for the status file
+    const char *checkpoint; // prefix of the checkpoint files of the runs, or NULL
+    double checkpoint_every; // seconds between checkpoints
+    int resume; // 1 to continue the runs from their checkpoints
+    int tempering; // sweeps between replica exchanges with the runs at the other temperatures, 0 for independent runs
+    ensemble *replicas; // runs exchanging configurations with this one, or NULL
+    int slot; // position of the run in its ensemble
+    int batch; // 1 to run the repetitions of a job as the lanes of one bit-sliced lattice
+    int lanes; // repetitions run in the batch of this one (itself and those after it), 0 if it runs in an earlier batch
+    int field; // 1 to keep the neighbour sum of every site, updated by the accepted flips, in the single-site sweeps
+    int block; // sweeps of the checkerboard order each layer makes before the wavefront moves on, 1 for whole half-sweeps
+    int replica; // repetition of the run
+    long job; // number of the run from its place in the parameter grid, selects its random number streams
+    uint64_t seed; // seed of all random number streams
+    double beta; // temperature
+} parameters;
+
+// a sweep over the lattice following a table of sites or random sites; the correlation sums of all axes are
+// updated by each flip unless sums is NULL
+typedef long (*sweep_function)( spin sigma[], const uint32_t table[], const double boltzmann[], rng *r, long sums[], int separation, int dim, int size );
+// the same sweep reading the neighbour sum of each site from field, which the accepted flips keep up to date
+typedef long (*field_sweep_function)( spin sigma[], signed char field[], const uint32_t table[], const double boltzmann[], rng *r, long sums[], int separation, int random, int dim, int size );
+// a sweep over a lattice stored along a curve, the neighbours found by dilated arithmetic (Morton, neighbours is NULL)
+// or from the table of the storage positions of the 2*dim neighbours of each stored site
+typedef long (*layout_sweep_function)( spin sigma[], const uint32_t table[], const uint32_t neighbours[], const double boltzmann[], rng *r, int random, int dim, int size );
+// a lattice padded with ghost sites: one layer before and after the lattice along each axis and, along x, as many
+// ghost sites after each row as the correlation reaches, each a copy of the site of the lattice it stands for, so
+// neighbours and correlation partners are read without wrapping around; stride[dim] is the padded size
+typedef struct{
+    int width; // ghost sites after each row
+    long stride[MAX_DIM+1];
+} halo;
+// a sweep over the padded positions of the table of a lattice with halos, in turn or at random
+typedef long (*halo_sweep_function)( spin sigma[], const uint32_t table[], const halo *pad, const double boltzmann[], rng *r, int random, int dim, int size );
+// a half-sweep of one sublattice (x+y+z)%2 == parity of the layers first <= z < last (x in 1D),
+// drawing from the random number stream of each layer
+typedef long (*half_sweep_function)( spin sigma[], int first, int last, int parity, const double boltzmann[], rng streams[], int dim, int size );
+// a number of Wolff clusters grown from random sites and flipped, one sweep; stack holds the sites of the growing cluster
+typedef long (*cluster_function)( spin sigma[], uint32_t stack[], const double boltzmann[], rng *r, long sums[], int separation, long clusters, int dim, int size );
+// the Swendsen-Wang bonds of the layers first <= z < last (x in 1D) to their neighbours up each axis, activated between
+// equal spins with probability 1-exp(-2*beta) from the random number stream of each layer and joined in parent
+typedef void (*bond_function)( const spin sigma[], uint32_t parent[], int first, int last, const double boltzmann[], rng streams[], int dim, int size );
+// a sweep over the sites of the table of up to 64 lattices stored bit-sliced, bit l of sigma[i] the spin of lane l
+// (set for +1); threshold[a] is the acceptance probability with a aligned neighbours as a 64 bit fraction
+typedef long (*batch_sweep_function)( uint64_t sigma[], const uint32_t table[], const uint64_t threshold[], uint64_t active, rng *r, int dim, int size );
+
+// sites of the n-fold way sorted by their number of aligned neighbours: the sites with a aligned neighbours are
+// sites[start[a]] ... sites[start[a+1]-1], and site i is at sites[position[i]]
+typedef struct{
+    uint32_t *sites;
+    uint32_t *position;
+    unsigned char *aligned; // aligned neighbours of each site
+    long start[2*MAX_DIM+2];
+} nfold;
+
+// a sweep of the rejection-free n-fold way: the flips that n random-site metropolis attempts would accept, each
+// drawn directly from the classes of aligned neighbours after a geometric number of attempts
+typedef long (*nfold_function)( spin sigma[], nfold *f, const double boltzmann[], rng *r, long sums[], int separation, int dim, int size );
+
+// sweep functions specialised for one dimension and size (0 for the generic ones)
+typedef struct{
+    int dim;
+    int size;
+    sweep_function random;
+    sweep_function table;
+    half_sweep_function half;
+    layout_sweep_function morton;
+    cluster_function cluster;
+    bond_function bonds;
+    batch_sweep_function batch;
+    nfold_function nfold;
+    field_sweep_function field;
+    halo_sweep_function halo;
+} kernel;
+
+// struct handed to each thread of the checkerboard and Swendsen-Wang update orders; the thread owns the layers
+// first <= z < last
+typedef struct{
+    int id;
+    int first;
+    int last;
+    int threads;
+    int depth; // sweeps of a temporal block, 1 for half-sweeps of the whole slab
+    int bins_number;
+    const parameters *p;
+    const double *boltzmann;
+    kernel k;
+    rng *streams; // random number streams of all layers, the thread only uses those of its own
+    spin *sigma; // lattice shared by all threads
+    uint32_t *parent; // Swendsen-Wang clusters: union-find forest, then the root of each site; NULL for the checkerboard
+    spin *flip; // Swendsen-Wang clusters: -1 at the root of a cluster that flips, otherwise 1
+    long *partial; // correlation sums of each slab for the current state, depth rows per thread
+    fft_plan *fft; // work space of the fft measurement, used by thread 0 only
+    stats *statistics; // correlation of the current bin and the running statistics, used by thread 0 only
+    long *observables; // sums of the observables of each slab for the current state, one row per thread, or NULL
+    series *history; // time series of the observables, used by thread 0 only
+    double *cpu_seconds; // cpu time of each thread up to the current bin
+    checkpoint *chain; // checkpoints of the run, written by thread 0
+    counters *count; // hardware counters of the thread, those of thread 0 are opened by the run
+    telemetry *status; // progress of the run, or NULL
+    pthread_barrier_t *barrier;
+} slab;
+
+
+long Power( int base, int exponent );
+int IsPower( int size, int base );
+int ParseMeasure( const char *name );
+void InitialiseSigma( const parameters *p, spin sigma[], rng *r );
+void BoltzmannTable( const parameters *p, double boltzmann[] );
+size_t JobBytes( const parameters *p, int bins_number );
+INLINE int NeighbourSum( const spin sigma[], long i, int dim, int size );
+INLINE int NeighbourSum_Morton( const spin sigma[], long i, int dim, int size );
+INLINE int NeighbourSum_Table( const spin sigma[], const uint32_t neighbours[], long i, int dim );
+INLINE void FlipSums( const spin sigma[], long i, long sums[], int separation, int dim, int size );
+void FieldInit( signed char field[], const spin sigma[], int dim, int size );
+INLINE void FieldFlip( signed char field[], long i, int change, int dim, int size );
+INLINE long SweepKernel( spin sigma[], signed char field[], const uint32_t table[], const double boltzmann[], rng *r, long sums[], int separation, int dim, int size, int random );
+INLINE long HalfSweepKernel( spin sigma[], int first, int last, int parity, const double boltzmann[], rng streams[], int dim, int size );
+long Sweep_Random( spin sigma[], const uint32_t table[], const double boltzmann[], rng *r, long sums[], int separation, int dim, int size );
+long Sweep_Table( spin sigma[], const uint32_t table[], const double boltzmann[], rng *r, long sums[], int separation, int dim, int size );
+INLINE long LayoutSweepKernel( spin sigma[], const uint32_t table[], const uint32_t neighbours[], const double boltzmann[], rng *r, int random, int dim, int size );
+INLINE long ClusterJoin( spin sigma[], uint32_t stack[], long top, long j, spin s, double add, rng *r, long sums[], int separation, int dim, int size );
+INLINE long ClusterKernel( spin sigma[], uint32_t stack[], const double boltzmann[], rng *r, long sums[], int separation, long clusters, int dim, int size );
+INLINE uint32_t ClusterRoot( uint32_t parent[], uint32_t i );
+INLINE void ClusterUnion( uint32_t parent[], uint32_t a, uint32_t b );
+INLINE void BondKernel( const spin sigma[], uint32_t parent[], int first, int last, const double boltzmann[], rng streams[], int dim, int size );
+void ClusterLabel( uint32_t parent[], spin flip[], int first, int last, rng streams[], int dim, int size );
+long ClusterFlip( spin sigma[], uint32_t parent[], const spin flip[], int first, int last, int dim, int size );
+long HalfSweep( spin sigma[], int first, int last, int parity, const double boltzmann[], rng streams[], int dim, int size );
+void Bonds( const spin sigma[], uint32_t parent[], int first, int last, const double boltzmann[], rng streams[], int dim, int size );
+long Sweep_Cluster( spin sigma[], uint32_t stack[], const double boltzmann[], rng *r, long sums[], int separation, long clusters, int dim, int size );
+INLINE void BatchCount( uint64_t count[3], uint64_t x );
+INLINE long BatchSweepKernel( uint64_t sigma[], const uint32_t table[], const uint64_t threshold[], uint64_t active, rng *r, int dim, int size );
+long Sweep_Batch( uint64_t sigma[], const uint32_t table[], const uint64_t threshold[], uint64_t active, rng *r, int dim, int size );
+void NFoldInit( nfold *f, const spin sigma[], int dim, int size, int sorted );
+INLINE void NFoldMove( nfold *f, uint32_t i, int to );
+INLINE long NFoldKernel( spin sigma[], nfold *f, const double boltzmann[], rng *r, long sums[], int separation, int dim, int size );
+long Sweep_NFold( spin sigma[], nfold *f, const double boltzmann[], rng *r, long sums[], int separation, int dim, int size );
+long Sweep_Field( spin sigma[], signed char field[], const uint32_t table[], const double boltzmann[], rng *r, long sums[], int separation, int random, int dim, int size );
+long WolffClusters( cluster_function cluster, spin sigma[], uint32_t stack[], const double boltzmann[], rng *r, long sums[], int separation, int dim, int size );
+long Sweep_Layout( spin sigma[], const uint32_t table[], const uint32_t neighbours[], const double boltzmann[], rng *r, int random, int dim, int size );
+void NeighbourTable( const parameters *p, const uint32_t curve[], const uint32_t position[], uint32_t neighbours[] );
+void HaloInit( halo *pad, int dim, int size, int separation );
+long HaloSites( int dim, int size, int separation );
+long HaloPosition( const halo *pad, long i, int dim, int size );
+void HaloFill( const halo *pad, const spin sigma[], spin padded[], int dim, int size );
+void HaloRow( const halo *pad, const spin padded[], spin sigma[], int dim, int size );
+INLINE void HaloFlip( spin sigma[], long i, const long stride[], int width, int dim, int size );
+INLINE long HaloSweepKernel( spin sigma[], const uint32_t table[], const halo *pad, const double boltzmann[], rng *r, int random, int dim, int size );
+long Sweep_Halo( spin sigma[], const uint32_t table[], const halo *pad, const double boltzmann[], rng *r, int random, int dim, int size );
+kernel FindKernel( int dim, int size );
+void CorrelationSums( const parameters *p, const spin sigma[], int first, int last, long sums[] );
+void CorrelationSums_Axes( const parameters *p, const spin sigma[], int first, int last, long sums[] );
+void ObservableSums( const parameters *p, const spin sigma[], int first, int last, long sums[] );
+void Correlation( const parameters *p, const spin sigma[], double bin[] );
+void Correlation_FFT( const parameters *p, const spin sigma[], fft_plan *f, double bin[] );
+void Correlation_Incremental( const parameters *p, const long sums[], double bin[] );
+void Correlation_Halo( const parameters *p, const halo *pad, const spin padded[], double bin[] );
+void Measure( const parameters *p, const spin sigma[], fft_plan *fft, double bin[] );
+void Slabs_Record( slab *task );
+long Slab_Wavefront( slab *task, long start, int count, const int from[], const int to[], long sums[] );
+long Slab_Block( slab *task, int sweeps, long sums[] );
+void *Slab_Update( void *arg );
+double Run_Slabs( const parameters *p, int bins_number, spin sigma[], const double boltzmann[], rng streams[], fft_plan *fft, stats *statistics, series *history, checkpoint *chain, counters *count, telemetry *status, arena *memory );
+void Run_Layout( const parameters *p, int bins_number, spin sigma[], const double boltzmann[], rng *r, fft_plan *fft, stats *statistics, series *history, checkpoint *chain, counters *count, telemetry *status, arena *memory );
+void Run_Halo( const parameters *p, int bins_number, spin sigma[], const double boltzmann[], rng *r, fft_plan *fft, stats *statistics, series *history, checkpoint *chain, counters *count, telemetry *status, arena *memory );
+int RunTables( const parameters *p );
+void RunFailed( const parameters *p, double avg[], double standard_deviation[] );
+void Run( const parameters *p, int bins_number, double avg[], double standard_deviation[], analysis *result, counts *events, telemetry *status );
+
+
+long Power( int base, int exponent ){
+    // return base^exponent
+    long result = 1;
+    for ( int i=0; i<exponent; i++ ){
+        result *= base;
+    }
+    return result;
+}
+
+int IsPower( int size, int base ){
+    // return 1 if size is a power of base, otherwise 0
+    long width = 1;
+    while ( width < size ){
+        width *= base;
+    }
+    return width == size;
+}
+
+int ParseMeasure( const char *name ){
+    // return the way of measuring with the given name, or -1
+    for ( int measure=0; measure<MEASURES; measure++ ){
+        if ( strcmp( name, MEASURE_NAMES[measure] ) == 0 ){
+            return measure;
+        }
+    }
+    return -1;
+}
+
+void InitialiseSigma( const parameters *p, spin sigma[], rng *r ){
+    // initialise array holding all spins by randomly assigning +/- 1, drawing the numbers a block at a time
+    double uniform[RANDOM_BLOCK];
+    for ( long start=0; start<p->n; start+=RANDOM_BLOCK ){
+        long count = p->n-start < RANDOM_BLOCK ? p->n-start : RANDOM_BLOCK;
+        RandomFill_Uniform( r, uniform, count );
+        for ( long i=0; i<count; i++ ){
+            if ( uniform[i] >= 0.5 ){
+                sigma[start+i] = 1;
+            }
+            else{
+                sigma[start+i] = -1;
+            }
+        }
+    }
+}
+
+void BoltzmannTable( const parameters *p, double boltzmann[] ){
+    // acceptance probability of a flip indexed by h+2*dim, where h = spin * (sum of neighbours) and e = 2*h
+    for ( int h=-2*p->dim; h<=2*p->dim; h++ ){
+        if ( h <= 0 ){
+            boltzmann[h+2*p->dim] = 1;
+        }
+        else{
+            boltzmann[h+2*p->dim] = exp( -2*h*p->beta );
+        }
+    }
+}
+
+size_t JobBytes( const parameters *p, int bins_number ){
+    // return the arena size needed by a run: the lattice, the correlation data and the work space of its update
+    // order, layout and measurement; the allocations of the run assert that they fit
+    size_t bytes = ArenaSize( p->n*sizeof(spin) ) + 3*ArenaSize( p->separation*sizeof(double) );
+    bytes += ArenaSize( p->separation*sizeof(long) );
+    if ( p->order == ORDER_CHECKERBOARD || p->order == ORDER_SWENDSEN_WANG ){
+        bytes += ArenaSize( (size_t)p->threads*(p->order == ORDER_CHECKERBOARD ? p->block : 1)*p->separation*sizeof(long) );
+    }
+    if ( p->layout == LAYOUT_HALO ){
+        bytes += ArenaSize( HaloSites( p->dim, p->size, p->separation )*sizeof(spin) ) + ArenaSize( p->n*sizeof(uint32_t) );
+    }
+    else if ( p->layout != LAYOUT_ROW ){
+        bytes += ArenaSize( p->n*sizeof(spin) ) + ArenaSize( p->n*2*p->dim*sizeof(uint32_t) );
+    }
+    if ( p->measure == MEASURE_FFT ){
+        bytes += FFTBytes( p->dim, p->size );
+    }
+    if ( p->order == ORDER_CHECKERBOARD || p->order == ORDER_SWENDSEN_WANG ){
+        bytes += ArenaSize( p->size*sizeof(rng) );
+    }
+    if ( p->order == ORDER_SWENDSEN_WANG ){
+        bytes += ArenaSize( p->n*sizeof(uint32_t) ) + ArenaSize( p->n*sizeof(spin) );
+    }
+    if ( p->order == ORDER_WOLFF ){
+        bytes += ArenaSize( p->n*sizeof(uint32_t) );
+    }
+    if ( p->order == ORDER_NFOLD ){
+        bytes += 2*ArenaSize( p->n*sizeof(uint32_t) ) + ArenaSize( p->n );
+    }
+    if ( p->field && p->layout == LAYOUT_ROW && p->order != ORDER_CHECKERBOARD && !AlgorithmOrder( p->order ) ){
+        bytes += ArenaSize( p->n );
+    }
+    if ( p->series ){
+        bytes += OBSERVABLES*ArenaSize( (size_t)bins_number*p->bins_size*sizeof(double) );
+        bytes += ArenaSize( (size_t)p->threads*SERIES_SUMS*sizeof(long) );
+    }
+    return bytes;
+}
+
+INLINE int NeighbourSum( const spin sigma[], long i, int dim, int size ){
+    // return the sum of the 2*dim neighbours of site i with periodic boundaries
+    int sum = 0;
+    long stride = 1;
+    for ( int axis=0; axis<dim; axis++ ){
+        int c = (i/stride)%size;
+        long up = c == size-1 ? i-(size-1)*stride : i+stride;
+        long down = c == 0 ? i+(size-1)*stride : i-stride;
+        sum += sigma[up] + sigma[down];
+        stride *= size;
+    }
+    return sum;
+}
+
+INLINE int NeighbourSum_Morton( const spin sigma[], long i, int dim, int size ){
+    // return the sum of the 2*dim neighbours of storage position i of a lattice stored along the Morton curve:
+    // adding or subtracting 1 in the bits of one axis (dilated arithmetic) wraps around on a power of 2
+    int bits = __builtin_ctz( size );
+    uint64_t all = ((uint64_t)1 << dim*bits) - 1;
+    int sum = 0;
+    for ( int axis=0; axis<dim; axis++ ){
+        uint64_t mask = MORTON_MASK[dim][axis] & all;
+        uint64_t rest = i & ~mask;
+        uint64_t up = (((i | ~mask) + 1) & mask) | rest;
+        uint64_t down = (((i & mask) - 1) & mask) | rest;
+        sum += sigma[up] + sigma[down];
+    }
+    return sum;
+}
+
+INLINE int NeighbourSum_Table( const spin sigma[], const uint32_t neighbours[], long i, int dim ){
+    // return the sum of the 2*dim neighbours of storage position i from the neighbour table
+    int sum = 0;
+    for ( int k=0; k<2*dim; k++ ){
+        sum += sigma[neighbours[i*2*dim+k]];
+    }
+    return sum;
+}
+
+INLINE void FlipSums( const spin sigma[], long i, long sums[], int separation, int dim, int size ){
+    // update the correlation sums of all axes for the flip of site i, before sigma[i] changes:
+    // the pairs (i, i+d) and (i-d, i) change by -2*sigma(i)*(sigma(i+d) + sigma(i-d))
+    long stride = 1;
+    for ( int axis=0; axis<dim; axis++ ){
+        int c = (i/stride)%size;
+        for ( int d=1; d<separation; d++ ){
+            int shift = d%size;
+            if ( shift == 0 ){
+                continue;
+            }
+            long up = c+shift < size ? i+shift*stride : i+(shift-size)*stride;
+            long down = c-shift >= 0 ? i-shift*stride : i+(size-shift)*stride;
+            sums[d] -= 2*sigma[i]*(sigma[up] + sigma[down]);
+        }
+        stride *= size;
+    }
+}
+
+void FieldInit( signed char field[], const spin sigma[], int dim, int size ){
+    // set the field of every site to the sum of its neighbours
+    long n = Power( size, dim );
+    for ( long i=0; i<n; i++ ){
+        field[i] = NeighbourSum( sigma, i, dim, size );
+    }
+}
+
+INLINE void FieldFlip( signed char field[], long i, int change, int dim, int size ){
+    // add change (twice the new spin) to the field of the 2*dim neighbours of the flipped site i
+    long stride = 1;
+    for ( int axis=0; axis<dim; axis++ ){
+        int c = (i/stride)%size;
+        long up = c == size-1 ? i-(size-1)*stride : i+stride;
+        long down = c == 0 ? i+(size-1)*stride : i-stride;
+        field[up] += change;
+        field[down] += change;
+        stride *= size;
+    }
+}
+
+INLINE long SweepKernel( spin sigma[], signed char field[], const uint32_t table[], const double boltzmann[], rng *r, long sums[], int separation, int dim, int size, int random ){
+    // one sweep of the metropolis algorithm over random sites or the sites of the table; return the accepted flips;
+    // with a field (not NULL) an attempt reads only its own site and the neighbours are visited by the accepted flips
+    long n = Power( size, dim );
+    long accepted = 0;
+    for ( long c=0; c<n; c++ ){
+        long i = random ? (long)RandomBelow( r, n ) : table[c];
+        int h = sigma[i]*(field != NULL ? field[i] : NeighbourSum( sigma, i, dim, size ));
+        if ( h <= 0 || RandomUniform( r ) < boltzmann[h+2*dim] ){
+            if ( sums != NULL ){
+                FlipSums( sigma, i, sums, separation, dim, size );
+            }
+            sigma[i] = -sigma[i];
+            if ( field != NULL ){
+                FieldFlip( field, i, 2*sigma[i], dim, size );
+            }
+            accepted++;
+        }
+    }
+    return accepted;
+}
+
+INLINE long HalfSweepKernel( spin sigma[], int first, int last, int parity, const double boltzmann[], rng streams[], int dim, int size ){
+    // update the sites (x+y+z)%2 == parity of the layers first <= z < last (x in 1D); return the accepted flips
+    long layer = Power( size, dim-1 );
+    long row = dim == 1 ? last-first : size;
+    long accepted = 0;
+    for ( long start=first*layer; start<last*layer; start+=row ){
+        int p = parity;
+        long stride = size;
+        for ( int axis=1; axis<dim; axis++ ){
+            p += (start/stride)%size;
+            stride *= size;
+        }
+        if ( dim == 1 ){
+            p += start;
+        }
+        for ( long i=start+p%2; i<start+row; i+=2 ){
+            int h = sigma[i]*NeighbourSum( sigma, i, dim, size );
+            if ( h <= 0 || RandomUniform( &streams[i/layer] ) < boltzmann[h+2*dim] ){
+                sigma[i] = -sigma[i];
+                accepted++;
+            }
+        }
+    }
+    return accepted;
+}
+
+INLINE long LayoutSweepKernel( spin sigma[], const uint32_t table[], const uint32_t neighbours[], const double boltzmann[], rng *r, int random, int dim, int size ){
+    // one sweep of the metropolis algorithm over the storage positions of the table of a lattice stored along
+    // a curve, in turn or at random; return the accepted flips
+    long n = Power( size, dim );
+    long accepted = 0;
+    for ( long c=0; c<n; c++ ){
+        long i = random ? table[RandomBelow( r, n )] : table[c];
+        int sum = neighbours == NULL ? NeighbourSum_Morton( sigma, i, dim, size ) : NeighbourSum_Table( sigma, neighbours, i, dim );
+        int h = sigma[i]*sum;
+        if ( h <= 0 || RandomUniform( r ) < boltzmann[h+2*dim] ){
+            sigma[i] = -sigma[i];
+            accepted++;
+        }
+    }
+    return accepted;
+}
+
+INLINE long ClusterJoin( spin sigma[], uint32_t stack[], long top, long j, spin s, double add, rng *r, long sums[], int separation, int dim, int size ){
+    // add site j to the cluster of spin s if it has that spin and the bond is activated: flip it and push it;
+    // return the new top of the stack
+    if ( sigma[j] == s && RandomUniform( r ) < add ){
+        if ( sums != NULL ){
+            FlipSums( sigma, j, sums, separation, dim, size );
+        }
+        sigma[j] = -s;
+        stack[top++] = j;
+    }
+    return top;
+}
+
+INLINE long ClusterKernel( spin sigma[], uint32_t stack[], const double boltzmann[], rng *r, long sums[], int separation, long clusters, int dim, int size ){
+    // grow and flip Wolff clusters from random sites, a bond to a neighbour of the same spin activated with
+    // probability 1-exp(-2*beta); a site is flipped as it joins, so its spin marks it as visited and nothing has to
+    // be cleared between clusters; return the flipped spins
+    long n = Power( size, dim );
+    double add = 1-boltzmann[2*dim+1];
+    long flipped = 0;
+    for ( long k=0; k<clusters; k++ ){
+        long seed = RandomBelow( r, n );
+        spin s = sigma[seed];
+        if ( sums != NULL ){
+            FlipSums( sigma, seed, sums, separation, dim, size );
+        }
+        sigma[seed] = -s;
+        stack[0] = seed;
+        long top = 1;
+        flipped++;
+        while ( top > 0 ){
+            long i = stack[--top];
+            long stride = 1;
+            for ( int axis=0; axis<dim; axis++ ){
+                int c = (i/stride)%size;
+                long up = c == size-1 ? i-(size-1)*stride : i+stride;
+                long down = c == 0 ? i+(size-1)*stride : i-stride;
+                long pushed = ClusterJoin( sigma, stack, top, up, s, add, r, sums, separation, dim, size );
+                pushed = ClusterJoin( sigma, stack, pushed, down, s, add, r, sums, separation, dim, size );
+                flipped += pushed-top;
+                top = pushed;
+                stride *= size;
+            }
+        }
+    }
+    return flipped;
+}
+
+INLINE uint32_t ClusterRoot( uint32_t parent[], uint32_t i ){
+    // return the root of site i, pointing every site on the way at its grandparent (path halving); a parent is
+    // never above its site, so any ancestor written by any thread is a valid parent
+    uint32_t up = __atomic_load_n( &parent[i], __ATOMIC_RELAXED );
+    while ( up != i ){
+        uint32_t above = __atomic_load_n( &parent[up], __ATOMIC_RELAXED );
+        if ( above != up ){
+            __atomic_store_n( &parent[i], above, __ATOMIC_RELAXED );
+        }
+        i = up;
+        up = above;
+    }
+    return i;
+}
+
+INLINE void ClusterUnion( uint32_t parent[], uint32_t a, uint32_t b ){
+    // join the clusters of sites a and b without locks: the larger root is pointed at the smaller by compare and
+    // swap, retried if another thread has linked it first; the root of a cluster is thus its smallest site
+    while ( 1 ){
+        a = ClusterRoot( parent, a );
+        b = ClusterRoot( parent, b );
+        if ( a == b ){
+            return;
+        }
+        if ( a < b ){
+            uint32_t c = a;
+            a = b;
+            b = c;
+        }
+        uint32_t expected = a;
+        if ( __atomic_compare_exchange_n( &parent[a], &expected, b, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) ){
+            return;
+        }
+    }
+}
+
+INLINE void BondKernel( const spin sigma[], uint32_t parent[], int first, int last, const double boltzmann[], rng streams[], int dim, int size ){
+    // activate the bonds of the layers first <= z < last to the neighbours up each axis and join their clusters
+    long layer = Power( size, dim-1 );
+    double add = 1-boltzmann[2*dim+1];
+    for ( long i=first*layer; i<last*layer; i++ ){
+        rng *r = &streams[i/layer];
+        long stride = 1;
+        for ( int axis=0; axis<dim; axis++ ){
+            int c = (i/stride)%size;
+            long up = c == size-1 ? i-(size-1)*stride : i+stride;
+            if ( sigma[i] == sigma[up] && RandomUniform( r ) < add ){
+                ClusterUnion( parent, i, up );
+            }
+            stride *= size;
+        }
+    }
+}
+
+void ClusterLabel( uint32_t parent[], spin flip[], int first, int last, rng streams[], int dim, int size ){
+    // point every site of the layers first <= z < last at its root and draw the flip of every root among them;
+    // the forest is only read on the way, path halving could overwrite the root another thread has just written
+    long layer = Power( size, dim-1 );
+    for ( long i=first*layer; i<last*layer; i++ ){
+        uint32_t root = i, up;
+        while ( (up = __atomic_load_n( &parent[root], __ATOMIC_RELAXED )) != root ){
+            root = up;
+        }
+        __atomic_store_n( &parent[i], root, __ATOMIC_RELAXED );
+        if ( root == i ){
+            flip[i] = RandomBelow( &streams[i/layer], 2 ) ? -1 : 1;
+        }
+    }
+}
+
+long ClusterFlip( spin sigma[], uint32_t parent[], const spin flip[], int first, int last, int dim, int size ){
+    // flip the sites of the layers first <= z < last whose cluster flips and make every site its own cluster again
+    // for the next sweep; return the flipped spins
+    long layer = Power( size, dim-1 );
+    long flipped = 0;
+    for ( long i=first*layer; i<last*layer; i++ ){
+        spin f = flip[parent[i]];
+        sigma[i] *= f;
+        flipped += f < 0;
+        parent[i] = i;
+    }
+    return flipped;
+}
+
+long Sweep_Random( spin sigma[], const uint32_t table[], const double boltzmann[], rng *r, long sums[], int separation, int dim, int size ){
+    // generic sweep over random sites
+    return SweepKernel( sigma, NULL, table, boltzmann, r, sums, separation, dim, size, 1 );
+}
+
+long Sweep_Table( spin sigma[], const uint32_t table[], const double boltzmann[], rng *r, long sums[], int separation, int dim, int size ){
+    // generic sweep over the sites of the table
+    return SweepKernel( sigma, NULL, table, boltzmann, r, sums, separation, dim, size, 0 );
+}
+
+long HalfSweep( spin sigma[], int first, int last, int parity, const double boltzmann[], rng streams[], int dim, int size ){
+    // generic checkerboard half-sweep
+    return HalfSweepKernel( sigma, first, last, parity, boltzmann, streams, dim, size );
+}
+
+void Bonds( const spin sigma[], uint32_t parent[], int first, int last, const double boltzmann[], rng streams[], int dim, int size ){
+    // generic Swendsen-Wang bonds
+    BondKernel( sigma, parent, first, last, boltzmann, streams, dim, size );
+}
+
+long Sweep_Cluster( spin sigma[], uint32_t stack[], const double boltzmann[], rng *r, long sums[], int separation, long clusters, int dim, int size ){
+    // generic Wolff sweep
+    return ClusterKernel( sigma, stack, boltzmann, r, sums, separation, clusters, dim, size );
+}
+
+INLINE void BatchCount( uint64_t count[3], uint64_t x ){
+    // add one bit per lane to the three bit planes of a count of up to 7
+    uint64_t carry = count[0] & x;
+    count[0] ^= x;
+    count[2] |= count[1] & carry;
+    count[1] ^= carry;
+}
+
+INLINE long BatchSweepKernel( uint64_t sigma[], const uint32_t table[], const uint64_t threshold[], uint64_t active, rng *r, int dim, int size ){
+    // one sweep of the metropolis algorithm over the sites of the table in every active lane of a bit-sliced
+    // lattice: flips with at most dim aligned neighbours are accepted, the others compare a uniform number of their
+    // own lane with the threshold of their count bit by bit from the top, 64 random bits for all lanes at a time,
+    // until every lane is decided; return the accepted flips
+    long n = Power( size, dim );
+    long accepted = 0;
+    for ( long c=0; c<n; c++ ){
+        long i = table[c];
+        uint64_t s = sigma[i];
+        uint64_t count[3] = { 0, 0, 0 };
+        long stride = 1;
+        for ( int axis=0; axis<dim; axis++ ){
+            int x = (i/stride)%size;
+            long up = x == size-1 ? i-(size-1)*stride : i+stride;
+            long down = x == 0 ? i+(size-1)*stride : i-stride;
+            BatchCount( count, ~(s ^ sigma[up]) );
+            BatchCount( count, ~(s ^ sigma[down]) );
+            stride *= size;
+        }
+        uint64_t aligned[MAX_DIM]; // lanes with dim+1+k aligned neighbours
+        uint64_t undecided = 0;
+        for ( int k=0; k<dim; k++ ){
+            int a = dim+1+k;
+            aligned[k] = (a & 1 ? count[0] : ~count[0]) & (a & 2 ? count[1] : ~count[1]) & (a & 4 ? count[2] : ~count[2]) & active;
+            undecided |= aligned[k];
+        }
+        uint64_t flip = active & ~undecided;
+        for ( int bit=63; bit>=0 && undecided; bit-- ){
+            uint64_t u = (uint64_t)Random32( r ) << 32 | Random32( r );
+            uint64_t t = 0;
+            for ( int k=0; k<dim; k++ ){
+                t |= aligned[k] & -((threshold[dim+1+k] >> bit) & 1);
+            }
+            flip |= undecided & ~u & t;
+            undecided &= ~(u ^ t);
+        }
+        sigma[i] = s ^ flip;
+        accepted += __builtin_popcountll( flip );
+    }
+    return accepted;
+}
+
+long Sweep_Batch( uint64_t sigma[], const uint32_t table[], const uint64_t threshold[], uint64_t active, rng *r, int dim, int size ){
+    // generic bit-sliced sweep
+    return BatchSweepKernel( sigma, table, threshold, active, r, dim, size );
+}
+
+void NFoldInit( nfold *f, const spin sigma[], int dim, int size, int sorted ){
+    // count the aligned neighbours of every site and sort the sites by them, or keep the order of sites if they are
+    // sorted already (from a checkpoint, where the order within each class picks the same sites again)
+    long n = Power( size, dim );
+    long count[2*MAX_DIM+1] = { 0 };
+    for ( long i=0; i<n; i++ ){
+        f->aligned[i] = (sigma[i]*NeighbourSum( sigma, i, dim, size ) + 2*dim)/2;
+        count[f->aligned[i]]++;
+    }
+    f->start[0] = 0;
+    for ( int a=0; a<=2*dim; a++ ){
+        f->start[a+1] = f->start[a] + count[a];
+        count[a] = f->start[a];
+    }
+    for ( long i=0; i<n; i++ ){
+        long k = sorted ? i : count[f->aligned[i]]++;
+        if ( !sorted ){
+            f->sites[k] = i;
+        }
+        f->position[f->sites[k]] = k;
+    }
+}
+
+INLINE void NFoldMove( nfold *f, uint32_t i, int to ){
+    // move site i to the class with to aligned neighbours one class at a time: up by swapping it to the end of its
+    // class and moving the start of the next one down, down by swapping it to the start and moving that up
+    int a = f->aligned[i];
+    while ( a != to ){
+        long k = a < to ? f->start[a+1]-1 : f->start[a];
+        uint32_t other = f->sites[k];
+        f->sites[f->position[i]] = other;
+        f->position[other] = f->position[i];
+        f->sites[k] = i;
+        f->position[i] = k;
+        if ( a < to ){
+            f->start[++a]--;
+        }
+        else{
+            f->start[a--]++;
+        }
+    }
+    f->aligned[i] = to;
+}
+
+INLINE long NFoldKernel( spin sigma[], nfold *f, const double boltzmann[], rng *r, long sums[], int separation, int dim, int size ){
+    // one sweep of n metropolis attempts on random sites without the rejections: a site with a aligned neighbours
+    // flips with probability boltzmann[2*a] per attempt on it, so the next flip comes after a geometric number of
+    // attempts with p = (sum of the rates of all sites)/n and is of a class chosen by its share of the rate, a site
+    // of the class chosen uniformly; the waiting time has no memory, so the attempts left at the end of the sweep
+    // are dropped; return the flips
+    long n = Power( size, dim );
+    double attempts = 0;
+    long flips = 0;
+    for ( ;; ){
+        double rate[2*MAX_DIM+1];
+        double total = 0;
+        for ( int a=0; a<=2*dim; a++ ){
+            rate[a] = (f->start[a+1]-f->start[a])*boltzmann[2*a];
+            total += rate[a];
+        }
+        double p = total/n;
+        attempts += p >= 1 ? 1 : 1 + floor( log( 1-RandomUniform( r ) )/log1p( -p ) );
+        if ( attempts > n ){
+            break;
+        }
+        // the class of the flip, the last one with a rate if rounding runs past the total
+        double x = RandomUniform( r )*total;
+        int a = 0;
+        for ( int c=0; c<=2*dim; c++ ){
+            if ( rate[c] > 0 ){
+                a = c;
+                if ( x < rate[c] ){
+                    break;
+                }
+                x -= rate[c];
+            }
+        }
+        uint32_t i = f->sites[f->start[a] + RandomBelow( r, f->start[a+1]-f->start[a] )];
+        if ( sums != NULL ){
+            FlipSums( sigma, i, sums, separation, dim, size );
+        }
+        sigma[i] = -sigma[i];
+        flips++;
+        NFoldMove( f, i, 2*dim-a );
+        long stride = 1;
+        for ( int axis=0; axis<dim; axis++ ){
+            int c = (i/stride)%size;
+            long up = c == size-1 ? i-(size-1)*stride : i+stride;
+            long down = c == 0 ? i+(size-1)*stride : i-stride;
+            NFoldMove( f, up, f->aligned[up] + (sigma[up] == sigma[i] ? 1 : -1) );
+            NFoldMove( f, down, f->aligned[down] + (sigma[down] == sigma[i] ? 1 : -1) );
+            stride *= size;
+        }
+    }
+    return flips;
+}
+
+long Sweep_NFold( spin sigma[], nfold *f, const double boltzmann[], rng *r, long sums[], int separation, int dim, int size ){
+    // generic n-fold way sweep
+    return NFoldKernel( sigma, f, boltzmann, r, sums, separation, dim, size );
+}
+
+long Sweep_Field( spin sigma[], signed char field[], const uint32_t table[], const double boltzmann[], rng *r, long sums[], int separation, int random, int dim, int size ){
+    // generic sweep with the neighbour sums kept in field
+    return random ? SweepKernel( sigma, field, table, boltzmann, r, sums, separation, dim, size, 1 ) :
+                    SweepKernel( sigma, field, table, boltzmann, r, sums, separation, dim, size, 0 );
+}
+
+long WolffClusters( cluster_function cluster, spin sigma[], uint32_t stack[], const double boltzmann[], rng *r, long sums[], int separation, int dim, int size ){
+    // return the clusters per sweep that flip as many spins as the lattice has on average, counted over
+    // WOLFF_CALIBRATION such sweeps at the start of a run; a sweep has to be a fixed number of clusters, ending it
+    // when n spins have flipped would measure after oversized clusters more often and bias the averages
+    long n = Power( size, dim );
+    long clusters = 0;
+    for ( long flipped=0; flipped<WOLFF_CALIBRATION*n; clusters++ ){
+        flipped += cluster( sigma, stack, boltzmann, r, sums, separation, 1, dim, size );
+    }
+    return clusters/WOLFF_CALIBRATION > 1 ? clusters/WOLFF_CALIBRATION : 1;
+}
+
+long Sweep_Layout( spin sigma[], const uint32_t table[], const uint32_t neighbours[], const double boltzmann[], rng *r, int random, int dim, int size ){
+    // generic sweep of a lattice stored along a curve
+    return LayoutSweepKernel( sigma, table, neighbours, boltzmann, r, random, dim, size );
+}
+
+void HaloInit( halo *pad, int dim, int size, int separation ){
+    // strides of a lattice padded by one layer of ghost sites on each side of every axis and, after each row, by
+    // the shifts d%size of the correlation (at least 1)
+    int reach = separation-1 < size-1 ? separation-1 : size-1;
+    pad->width = reach > 1 ? reach : 1;
+    pad->stride[0] = 1;
+    for ( int axis=0; axis<dim; axis++ ){
+        pad->stride[axis+1] = pad->stride[axis]*(axis == 0 ? size+1+pad->width : size+2);
+    }
+}
+
+long HaloSites( int dim, int size, int separation ){
+    // return the padded size of a lattice with halos
+    halo pad;
+    HaloInit( &pad, dim, size, separation );
+    return pad.stride[dim];
+}
+
+long HaloPosition( const halo *pad, long i, int dim, int size ){
+    // return the padded position of the row-major site i
+    long position = 0;
+    for ( int axis=0; axis<dim; axis++ ){
+        position += (i%size + 1)*pad->stride[axis];
+        i /= size;
+    }
+    return position;
+}
+
+void HaloFill( const halo *pad, const spin sigma[], spin padded[], int dim, int size ){
+    // copy a row-major lattice to every padded position, ghosts included, from the site each stands for
+    for ( long q=0; q<pad->stride[dim]; q++ ){
+        long i = 0, volume = 1;
+        for ( int axis=0; axis<dim; axis++ ){
+            long c = (q/pad->stride[axis]) % (pad->stride[axis+1]/pad->stride[axis]) - 1;
+            i += (c+size)%size*volume;
+            volume *= size;
+        }
+        padded[q] = sigma[i];
+    }
+}
+
+void HaloRow( const halo *pad, const spin padded[], spin sigma[], int dim, int size ){
+    // copy the sites of a lattice with halos back to row-major order
+    long n = Power( size, dim );
+    long rows = n/size;
+    for ( long r=0; r<rows; r++ ){
+        memcpy( &sigma[r*size], &padded[HaloPosition( pad, r*size, dim, size )], size*sizeof(spin) );
+    }
+}
+
+INLINE void HaloFlip( spin sigma[], long i, const long stride[], int width, int dim, int size ){
+    // copy the new spin of the padded position i to its ghosts: before the lattice if it is the last site of an
+    // axis, after it if it is the first (along x, one of the first width)
+    for ( int axis=0; axis<dim; axis++ ){
+        int c = (i/stride[axis]) % (axis == 0 ? size+1+width : size+2) - 1;
+        if ( c == size-1 ){
+            sigma[i-size*stride[axis]] = sigma[i];
+        }
+        if ( c < (axis == 0 ? width : 1) ){
+            sigma[i+size*stride[axis]] = sigma[i];
+        }
+    }
+}
+
+INLINE long HaloSweepKernel( spin sigma[], const uint32_t table[], const halo *pad, const double boltzmann[], rng *r, int random, int dim, int size ){
+    // one sweep of the metropolis algorithm over the padded positions of the table of a lattice with halos, in turn
+    // or at random: every site has its neighbours at fixed offsets, and an accepted flip is copied to its ghosts;
+    // return the accepted flips
+    long n = Power( size, dim );
+    long stride[MAX_DIM];
+    for ( int axis=0; axis<dim; axis++ ){
+        stride[axis] = pad->stride[axis];
+    }
+    int width = pad->width;
+    long accepted = 0;
+    for ( long c=0; c<n; c++ ){
+        long i = random ? table[RandomBelow( r, n )] : table[c];
+        int sum = 0;
+        for ( int axis=0; axis<dim; axis++ ){
+            sum += sigma[i+stride[axis]] + sigma[i-stride[axis]];
+        }
+        int h = sigma[i]*sum;
+        if ( h <= 0 || RandomUniform( r ) < boltzmann[h+2*dim] ){
+            sigma[i] = -sigma[i];
+            HaloFlip( sigma, i, stride, width, dim, size );
+            accepted++;
+        }
+    }
+    return accepted;
+}
+
+long Sweep_Halo( spin sigma[], const uint32_t table[], const halo *pad, const double boltzmann[], rng *r, int random, int dim, int size ){
+    // generic sweep of a lattice with halos
+    return random ? HaloSweepKernel( sigma, table, pad, boltzmann, r, 1, dim, size ) : HaloSweepKernel( sigma, table, pad, boltzmann, r, 0, dim, size );
+}
+
+// sweep functions with the dimension D and size L fixed at compile time
+#define KERNEL_INSTANCE( D, L ) \
+long Sweep_Random_##D##_##L( spin sigma[], const uint32_t table[], const double boltzmann[], rng *r, long sums[], int separation, int dim, int size ){ \
+    return SweepKernel( sigma, NULL, table, boltzmann, r, sums, separation, D, L, 1 ); \
+} \
+long Sweep_Table_##D##_##L( spin sigma[], const uint32_t table[], const double boltzmann[], rng *r, long sums[], int separation, int dim, int size ){ \
+    return SweepKernel( sigma, NULL, table, boltzmann, r, sums, separation, D, L, 0 ); \
+} \
+long HalfSweep_##D##_##L( spin sigma[], int first, int last, int parity, const double boltzmann[], rng streams[], int dim, int size ){ \
+    return HalfSweepKernel( sigma, first, last, parity, boltzmann, streams, D, L ); \
+} \
+long Sweep_Morton_##D##_##L( spin sigma[], const uint32_t table[], const uint32_t neighbours[], const double boltzmann[], rng *r, int random, int dim, int size ){ \
+    return random ? LayoutSweepKernel( sigma, table, NULL, boltzmann, r, 1, D, L ) : LayoutSweepKernel( sigma, table, NULL, boltzmann, r, 0, D, L ); \
+} \
+long Sweep_Cluster_##D##_##L( spin sigma[], uint32_t stack[], const double boltzmann[], rng *r, long sums[], int separation, long clusters, int dim, int size ){ \
+    return ClusterKernel( sigma, stack, boltzmann, r, sums, separation, clusters, D, L ); \
+} \
+void Bonds_##D##_##L( const spin sigma[], uint32_t parent[], int first, int last, const double boltzmann[], rng streams[], int dim, int size ){ \
+    BondKernel( sigma, parent, first, last, boltzmann, streams, D, L ); \
+} \
+long Sweep_Batch_##D##_##L( uint64_t sigma[], const uint32_t table[], const uint64_t threshold[], uint64_t active, rng *r, int dim, int size ){ \
+    return BatchSweepKernel( sigma, table, threshold, active, r, D, L ); \
+} \
+long Sweep_NFold_##D##_##L( spin sigma[], nfold *f, const double boltzmann[], rng *r, long sums[], int separation, int dim, int size ){ \
+    return NFoldKernel( sigma, f, boltzmann, r, sums, separation, D, L ); \
+} \
+long Sweep_Field_##D##_##L( spin sigma[], signed char field[], const uint32_t table[], const double boltzmann[], rng *r, long sums[], int separation, int random, int dim, int size ){ \
+    return random ? SweepKernel( sigma, field, table, boltzmann, r, sums, separation, D, L, 1 ) : \
+                    SweepKernel( sigma, field, table, boltzmann, r, sums, separation, D, L, 0 ); \
+} \
+long Sweep_Halo_##D##_##L( spin sigma[], const uint32_t table[], const halo *pad, const double boltzmann[], rng *r, int random, int dim, int size ){ \
+    return random ? HaloSweepKernel( sigma, table, pad, boltzmann, r, 1, D, L ) : HaloSweepKernel( sigma, table, pad, boltzmann, r, 0, D, L ); \
+}
+#define KERNEL_ENTRY( D, L ) { D, L, Sweep_Random_##D##_##L, Sweep_Table_##D##_##L, HalfSweep_##D##_##L, Sweep_Morton_##D##_##L, \
+                               Sweep_Cluster_##D##_##L, Bonds_##D##_##L, Sweep_Batch_##D##_##L, Sweep_NFold_##D##_##L, Sweep_Field_##D##_##L, \
+                               Sweep_Halo_##D##_##L }
+
+KERNEL_INSTANCE( 1, 1000 )
+KERNEL_INSTANCE( 1, 1024 )
+KERNEL_INSTANCE( 2, 16 )
+KERNEL_INSTANCE( 2, 32 )
+KERNEL_INSTANCE( 2, 64 )
+KERNEL_INSTANCE( 2, 128 )
+KERNEL_INSTANCE( 2, 256 )
+KERNEL_INSTANCE( 3, 8 )
+KERNEL_INSTANCE( 3, 16 )
+KERNEL_INSTANCE( 3, 32 )
+KERNEL_INSTANCE( 3, 64 )
+
+const kernel KERNELS[] = {
+    KERNEL_ENTRY( 1, 1000 ), KERNEL_ENTRY( 1, 1024 ),
+    KERNEL_ENTRY( 2, 16 ), KERNEL_ENTRY( 2, 32 ), KERNEL_ENTRY( 2, 64 ), KERNEL_ENTRY( 2, 128 ), KERNEL_ENTRY( 2, 256 ),
+    KERNEL_ENTRY( 3, 8 ), KERNEL_ENTRY( 3, 16 ), KERNEL_ENTRY( 3, 32 ), KERNEL_ENTRY( 3, 64 )
+};
+
+kernel FindKernel( int dim, int size ){
+    // return the kernels specialised for the lattice, or the generic ones
+    for ( int i=0; i<(int)(sizeof(KERNELS)/sizeof(KERNELS[0])); i++ ){
+        if ( KERNELS[i].dim == dim && KERNELS[i].size == size ){
+            return KERNELS[i];
+        }
+    }
+    kernel k = { 0, 0, Sweep_Random, Sweep_Table, HalfSweep, Sweep_Layout, Sweep_Cluster, Bonds, Sweep_Batch, Sweep_NFold, Sweep_Field, Sweep_Halo };
+    return k;
+}
+
+void NeighbourTable( const parameters *p, const uint32_t curve[], const uint32_t position[], uint32_t neighbours[] ){
+    // storage positions of the 2*dim neighbours of each stored site, up before down along each axis;
+    // curve gives the site stored at each position and position the storage position of each site
+    int size = p->size;
+    for ( long s=0; s<p->n; s++ ){
+        long i = curve[s];
+        long stride = 1;
+        for ( int axis=0; axis<p->dim; axis++ ){
+            int c = (i/stride)%size;
+            long up = c == size-1 ? i-(size-1)*stride : i+stride;
+            long down = c == 0 ? i+(size-1)*stride : i-stride;
+            neighbours[s*2*p->dim+2*axis] = position[up];
+            neighbours[s*2*p->dim+2*axis+1] = position[down];
+            stride *= size;
+        }
+    }
+}
+
+void CorrelationSums( const parameters *p, const spin sigma[], int first, int last, long sums[] ){
+    // sum sigma(x)*sigma(x+d) along x over the sites of the layers first <= z < last (x in 1D) for all d
+    int size = p->size;
+    long layer = Power( size, p->dim-1 );
+    long row = p->dim == 1 ? last-first : size;
+
+    for ( int d=0; d<p->separation; d++ ){
+        sums[d] = 0;
+        int shift = d%size;
+        for ( long start=first*layer; start<last*layer; start+=row ){
+            long base = p->dim == 1 ? 0 : start;
+            for ( long i=start; i<start+row; i++ ){
+                long x = i-base;
+                sums[d] += sigma[i]*sigma[base + (x+shift < size ? x+shift : x+shift-size)];
+            }
+        }
+    }
+}
+
+void CorrelationSums_Axes( const parameters *p, const spin sigma[], int first, int last, long sums[] ){
+    // sum sigma(i)*sigma(i+d) along every axis over the sites of the layers first <= z < last (x in 1D) for all d
+    int size = p->size;
+    long layer = Power( size, p->dim-1 );
+
+    for ( int d=0; d<p->separation; d++ ){
+        sums[d] = 0;
+        int shift = d%size;
+        long stride = 1;
+        for ( int axis=0; axis<p->dim; axis++ ){
+            for ( long i=first*layer; i<last*layer; i++ ){
+                int c = (i/stride)%size;
+                sums[d] += sigma[i]*sigma[c+shift < size ? i+shift*stride : i+(shift-size)*stride];
+            }
+            stride *= size;
+        }
+    }
+}
+
+void ObservableSums( const parameters *p, const spin sigma[], int first, int last, long sums[] ){
+    // sum the spins, sigma(i)*sigma(i+1) along every axis and sigma(i)*sigma(i+1) along x over the sites of the
+    // layers first <= z < last (x in 1D)
+    int size = p->size;
+    long layer = Power( size, p->dim-1 );
+    for ( int k=0; k<SERIES_SUMS; k++ ){
+        sums[k] = 0;
+    }
+    for ( long i=first*layer; i<last*layer; i++ ){
+        sums[0] += sigma[i];
+        long stride = 1;
+        for ( int axis=0; axis<p->dim; axis++ ){
+            int c = (i/stride)%size;
+            int bond = sigma[i]*sigma[c == size-1 ? i-(size-1)*stride : i+stride];
+            sums[1] += bond;
+            if ( axis == 0 ){
+                sums[2] += bond;
+            }
+            stride *= size;
+        }
+    }
+}
+
+void Correlation( const parameters *p, const spin sigma[], double bin[] ){
+    // calculate the correletion between a site and a site 'd' away along x for all d<separation and add it to the bin
+    long sums[p->separation];
+    CorrelationSums( p, sigma, 0, p->size, sums );
+
+    double norm = (double)p->n*p->bins_size;
+    for ( int d=0; d<p->separation; d++ ){
+        bin[d] += sums[d]/norm;
+    }
+}
+
+void Correlation_FFT( const parameters *p, const spin sigma[], fft_plan *f, double bin[] ){
+    // calculate the correlation for all separations d<=size/2 from the power spectrum of the lattice,
+    // sum over x of sigma(x)*sigma(x+r) = inverse fft of |fft(sigma)|^2 / n, averaged over the axes
+    for ( long i=0; i<p->n; i++ ){
+        f->re[i] = sigma[i];
+        f->im[i] = 0;
+    }
+    FFTLattice( f, 0 );
+    for ( long i=0; i<p->n; i++ ){
+        f->re[i] = f->re[i]*f->re[i] + f->im[i]*f->im[i];
+        f->im[i] = 0;
+    }
+    FFTLattice( f, 1 );
+
+    double norm = (double)p->n*p->n*p->dim*p->bins_size;
+    for ( int d=0; d<p->separation; d++ ){
+        double sum = 0;
+        long stride = 1;
+        for ( int axis=0; axis<p->dim; axis++ ){
+            sum += f->re[(d%p->size)*stride];
+            stride *= p->size;
+        }
+        bin[d] += sum/norm;
+    }
+}
+
+void Correlation_Incremental( const parameters *p, const long sums[], double bin[] ){
+    // save the correlation sums of all axes kept up to date by the sweeps, averaged over the axes
+    double norm = (double)p->n*p->dim*p->bins_size;
+    for ( int d=0; d<p->separation; d++ ){
+        bin[d] += sums[d]/norm;
+    }
+}
+
+void Correlation_Halo( const parameters *p, const halo *pad, const spin padded[], double bin[] ){
+    // calculate the correlation along x of a lattice with halos, the partners past the end of a row read from its
+    // ghosts, and add it to the bin
+    int size = p->size;
+    long rows = p->n/size;
+    double norm = (double)p->n*p->bins_size;
+    for ( int d=0; d<p->separation; d++ ){
+        int shift = d%size;
+        long sum = 0;
+        for ( long r=0; r<rows; r++ ){
+            const spin *row = &padded[HaloPosition( pad, r*size, p->dim, size )];
+            int products = 0; // at most size, summed in int so the loop vectorises
+            for ( int x=0; x<size; x++ ){
+                products += row[x]*row[x+shift];
+            }
+            sum += products;
+        }
+        bin[d] += sum/norm;
+    }
+}
+
+void Measure( const parameters *p, const spin sigma[], fft_plan *fft, double bin[] ){
+    // measure the correlation of a row-major lattice directly or by fft
+    if ( p->measure == MEASURE_FFT ){
+        Correlation_FFT( p, sigma, fft, bin );
+    }
+    else{
+        Correlation( p, sigma, bin );
+    }
+}
+
+void Slabs_Record( slab *task ){
+    // add up the observable sums of all slabs and record them in the time series
+    long sums[SERIES_SUMS] = { 0 };
+    for ( int t=0; t<task->threads; t++ ){
+        for ( int k=0; k<SERIES_SUMS; k++ ){
+            sums[k] += task->observables[t*SERIES_SUMS+k];
+        }
+    }
+    SeriesRecord( task->history, task->p->n, sums );
+}
+
+long Slab_Wavefront( slab *task, long start, int count, const int from[], const int to[], long sums[] ){
+    // advance the layers start, start+1, ... (count of them, around the lattice) from half-sweep from[u] to to[u]
+    // of a temporal block along a skewed wavefront: layer u makes half-sweep k at step u+k, after half-sweep k-1 of
+    // layer u+1, so neighbouring layers are never more than one half-sweep apart and the few layers of the front
+    // stay in cache for all the half-sweeps; a layer that completes sweep s adds its correlation along x to row s of
+    // sums; return the accepted flips
+    const parameters *p = task->p;
+    int top = 0;
+    for ( int u=0; u<count; u++ ){
+        top = to[u] > top ? to[u] : top;
+    }
+    long layer[p->separation];
+    long accepted = 0;
+    for ( int w=0; w<count+top; w++ ){
+        for ( int k=(w-count+1 > 0 ? w-count+1 : 0); k<top && k<=w; k++ ){
+            int u = w-k;
+            if ( k < from[u] || k >= to[u] ){
+                continue;
+            }
+            int z = (start+u)%p->size;
+            accepted += task->k.half( task->sigma, z, z+1, k%2, task->boltzmann, task->streams, p->dim, p->size );
+            if ( k%2 == 1 ){
+                CorrelationSums( p, task->sigma, z, z+1, layer );
+                for ( int d=0; d<p->separation; d++ ){
+                    sums[(long)(k/2)*p->separation+d] += layer[d];
+                }
+            }
+        }
+    }
+    return accepted;
+}
+
+long Slab_Block( slab *task, int sweeps, long sums[] ){
+    // make sweeps checkerboard sweeps of the lattice in two wavefronts per thread: the first raises the layers of
+    // the slab to a tent, min(2*sweeps, distance to the ends of the slab) half-sweeps, its end layers untouched so
+    // the slabs do not meet; the second completes the valley of 2*sweeps layers either side of the first layer of
+    // the slab, which the layers outside, already complete, do not enter; each layer draws from its own stream in
+    // the same order as in half-sweeps of the whole lattice, so the chain is the same; return the accepted flips
+    int width = task->last-task->first;
+    int from[width], to[width]; // the valley is 4*sweeps < width layers
+    for ( int u=0; u<width; u++ ){
+        int edge = u < width-1-u ? u : width-1-u;
+        from[u] = 0;
+        to[u] = edge < 2*sweeps ? edge : 2*sweeps;
+    }
+    long accepted = Slab_Wavefront( task, task->first, width, from, to, sums );
+    pthread_barrier_wait( task->barrier );
+    for ( int u=0; u<4*sweeps; u++ ){
+        int offset = u-2*sweeps; // from the first layer of the slab
+        from[u] = offset >= 0 ? offset : -offset-1;
+        to[u] = 2*sweeps;
+    }
+    accepted += Slab_Wavefront( task, task->first-2*sweeps+task->p->size, 4*sweeps, from, to, sums );
+    pthread_barrier_wait( task->barrier );
+    return accepted;
+}
+
+void *Slab_Update( void *arg ){
+    // update the slab of one thread: one sublattice per half-sweep, or the bonds, labels and flips of the
+    // Swendsen-Wang clusters; the threads meet at a barrier after each half-sweep or step of the clusters and
+    // after each correlation measurement; the wait at a barrier is counted in the phase before it
+    slab *task = (slab *)arg;
+    const parameters *p = task->p;
+    int separation = p->separation;
+    double norm = (double)p->n*p->bins_size*(p->measure == MEASURE_INCREMENTAL ? p->dim : 1);
+    if ( task->id > 0 ){
+        CountersOpen( task->count, p->counters, p->counters );
+    }
+
+    checkpoint *chain = task->chain;
+    for ( int a=chain->header.bins; a<task->bins_number; a++ ){
+        // temporal blocks of the checkerboard order, measured layer by layer as each completes a sweep; thread 0 adds
+        // the sums of each sweep in turn, as after half-sweeps of the whole lattice
+        for ( int b=0, sweeps; b<p->bins_size && task->depth>1; b+=sweeps ){
+            sweeps = p->bins_size-b < task->depth ? p->bins_size-b : task->depth;
+            CountersPhase( task->count, PHASE_SWEEP );
+            long *sums = &task->partial[(long)task->id*task->depth*separation];
+            memset( sums, 0, (size_t)sweeps*separation*sizeof(long) );
+            long accepted = Slab_Block( task, sweeps, sums );
+            CountersPhase( task->count, PHASE_REDUCE );
+            TelemetrySweep( task->status, task->id == 0 ? sweeps : 0, accepted, task->count );
+            if ( task->id == 0 ){
+                for ( int s=0; s<sweeps; s++ ){
+                    for ( int d=0; d<separation; d++ ){
+                        long sum = 0;
+                        for ( int t=0; t<task->threads; t++ ){
+                            sum += task->partial[((long)t*task->depth+s)*separation+d];
+                        }
+                        task->statistics->bin[d] += sum/norm;
+                    }
+                }
+            }
+            pthread_barrier_wait( task->barrier );
+        }
+        for ( int b=0; b<p->bins_size && task->depth==1; b++ ){
+            CountersPhase( task->count, PHASE_SWEEP );
+            long accepted = 0;
+            if ( task->parent != NULL ){
+                task->k.bonds( task->sigma, task->parent, task->first, task->last, task->boltzmann, task->streams, p->dim, p->size );
+                pthread_barrier_wait( task->barrier );
+                ClusterLabel( task->parent, task->flip, task->first, task->last, task->streams, p->dim, p->size );
+                pthread_barrier_wait( task->barrier );
+                accepted = ClusterFlip( task->sigma, task->parent, task->flip, task->first, task->last, p->dim, p->size );
+                pthread_barrier_wait( task->barrier );
+            }
+            for ( int parity=0; parity<2 && task->parent==NULL; parity++ ){
+                accepted += task->k.half( task->sigma, task->first, task->last, parity, task->boltzmann, task->streams, p->dim, p->size );
+                pthread_barrier_wait( task->barrier );
+            }
+            CountersPhase( task->count, PHASE_MEASURE );
+            TelemetrySweep( task->status, task->id == 0, accepted, task->count );
+            if ( task->observables != NULL ){
+                ObservableSums( p, task->sigma, task->first, task->last, &task->observables[task->id*SERIES_SUMS] );
+            }
+            if ( p->measure == MEASURE_FFT ){
+                if ( task->id == 0 ){
+                    Correlation_FFT( p, task->sigma, task->fft, task->statistics->bin );
+                }
+                pthread_barrier_wait( task->barrier );
+                if ( task->id == 0 && task->observables != NULL ){
+                    CountersPhase( task->count, PHASE_REDUCE );
+                    Slabs_Record( task );
+                }
+                continue;
+            }
+            if ( p->measure == MEASURE_INCREMENTAL ){
+                CorrelationSums_Axes( p, task->sigma, task->first, task->last, &task->partial[(long)task->id*separation] );
+            }
+            else{
+                CorrelationSums( p, task->sigma, task->first, task->last, &task->partial[(long)task->id*separation] );
+            }
+            pthread_barrier_wait( task->barrier );
+            if ( task->id == 0 ){
+                CountersPhase( task->count, PHASE_REDUCE );
+                for ( int d=0; d<separation; d++ ){
+                    long sum = 0;
+                    for ( int t=0; t<task->threads; t++ ){
+                        sum += task->partial[(long)t*separation+d];
+                    }
+                    task->statistics->bin[d] += sum/norm;
+                }
+                if ( task->observables != NULL ){
+                    Slabs_Record( task );
+                }
+            }
+        }
+        // with checkpoints every thread stops at the end of the bin until thread 0 has written one
+        CountersPhase( task->count, PHASE_REDUCE );
+        task->cpu_seconds[task->id] = CpuSeconds();
+        if ( chain->name[0] != 0 ){
+            pthread_barrier_wait( task->barrier );
+        }
+        if ( task->id == 0 ){
+            StatsCloseBin( task->statistics );
+            TelemetryBin( task->status, a+1 );
+            if ( chain->name[0] != 0 ){
+                chain->helpers = 0;
+                for ( int t=1; t<task->threads; t++ ){
+                    chain->helpers += task->cpu_seconds[t];
+                }
+                CheckpointBin( chain, a == task->bins_number-1 );
+            }
+        }
+        if ( chain->name[0] != 0 ){
+            pthread_barrier_wait( task->barrier );
+        }
+    }
+    task->cpu_seconds[task->id] = CpuSeconds();
+    if ( task->id > 0 ){
+        CountersClose( task->count );
+    }
+    return NULL;
+}
+
+double Run_Slabs( const parameters *p, int bins_number, spin sigma[], const double boltzmann[], rng streams[], fft_plan *fft, stats *statistics, series *history, checkpoint *chain, counters *count, telemetry *status, arena *memory ){
+    // run the metropolis algorithm in checkerboard order, or the Swendsen-Wang algorithm, with every thread owning
+    // a slab of whole layers; each layer has its own random number stream, and a Swendsen-Wang cluster is labelled
+    // by its smallest site whichever thread joined it, so the chain does not depend on the number of threads;
+    // flips of different slabs would race on shared sums, so the incremental measurement rescans each slab instead;
+    // the counts of the threads started here are added to those of the calling thread; return their cpu time;
+    // temporal blocks of the checkerboard order need slabs of at least 4*depth+1 layers
+    int threads = p->size < p->threads ? p->size : p->threads;
+    int depth = 1;
+    if ( p->order == ORDER_CHECKERBOARD && p->block > 1 && p->dim > 1 ){
+        depth = p->block < (p->size-1)/4 ? p->block : (p->size-1)/4;
+    }
+    if ( depth > 1 && threads > p->size/(4*depth+1) ){
+        threads = p->size/(4*depth+1);
+    }
+    depth = depth > 1 ? depth : 1;
+    long *partial = ArenaAlloc( memory, (long)threads*depth*p->separation*sizeof(long) );
+    long *observables = p->series ? ArenaAlloc( memory, (long)threads*SERIES_SUMS*sizeof(long) ) : NULL;
+    assert( partial != NULL && (observables != NULL || !p->series) );
+    uint32_t *parent = NULL;
+    spin *flip = NULL;
+    if ( p->order == ORDER_SWENDSEN_WANG ){
+        parent = ArenaAlloc( memory, p->n*sizeof(uint32_t) );
+        flip = ArenaAlloc( memory, p->n*sizeof(spin) );
+        assert( parent != NULL && flip != NULL );
+        for ( long s=0; s<p->n; s++ ){
+            parent[s] = s;
+        }
+    }
+    double cpu_seconds[threads];
+    slab tasks[threads];
+    counters helpers[threads];
+    pthread_t handles[threads];
+    pthread_barrier_t barrier;
+    pthread_barrier_init( &barrier, NULL, threads );
+
+    for ( int t=0; t<threads; t++ ){
+        tasks[t].id = t;
+        tasks[t].first = (long)t*p->size/threads;
+        tasks[t].last = (long)(t+1)*p->size/threads;
+        tasks[t].threads = threads;
+        tasks[t].depth = depth;
+        tasks[t].bins_number = bins_number;
+        tasks[t].p = p;
+        tasks[t].boltzmann = boltzmann;
+        tasks[t].k = FindKernel( p->dim, p->size );
+        tasks[t].streams = streams;
+        tasks[t].sigma = sigma;
+        tasks[t].parent = parent;
+        tasks[t].flip = flip;
+        tasks[t].partial = partial;
+        tasks[t].fft = fft;
+        tasks[t].statistics = statistics;
+        tasks[t].observables = observables;
+        tasks[t].history = history;
+        tasks[t].cpu_seconds = cpu_seconds;
+        tasks[t].chain = chain;
+        tasks[t].count = t == 0 ? count : &helpers[t];
+        tasks[t].status = status;
+        tasks[t].barrier = &barrier;
+    }
+    for ( int t=1; t<threads; t++ ){
+        pthread_create( &handles[t], NULL, Slab_Update, &tasks[t] );
+    }
+    Slab_Update( &tasks[0] );
+    double seconds = 0;
+    for ( int t=1; t<threads; t++ ){
+        pthread_join( handles[t], NULL );
+        CountsAdd( &count->total, &helpers[t].total );
+        seconds += cpu_seconds[t];
+    }
+    pthread_barrier_destroy( &barrier );
+    return seconds;
+}
+
+void Run_Layout( const parameters *p, int bins_number, spin sigma[], const double boltzmann[], rng *r, fft_plan *fft, stats *statistics, series *history, checkpoint *chain, counters *count, telemetry *status, arena *memory ){
+    // run the metropolis algorithm on a lattice stored along the Morton or Hilbert curve; the sites are visited
+    // and the random numbers drawn as in the row layout, so the chain is the same and only the memory access
+    // differs; the spins are copied back to row-major order for each measurement
+    int extent[MAX_DIM] = { p->size, p->size, p->size };
+    const uint32_t *table = OrderTable( p->order == ORDER_RANDOM ? ORDER_ORDER : p->order, p->layout, p->dim, extent );
+    const uint32_t *curve = OrderTable( LAYOUT_CURVE[p->layout], LAYOUT_ROW, p->dim, extent );
+    spin *view = ArenaAlloc( memory, p->n*sizeof(spin) );
+    assert( view != NULL );
+    for ( long s=0; s<p->n; s++ ){
+        view[s] = sigma[curve[s]];
+    }
+    memcpy( sigma, view, p->n*sizeof(spin) );
+    chain->lattice = view;
+
+    uint32_t *neighbours = NULL;
+    layout_sweep_function sweep = FindKernel( p->dim, p->size ).morton;
+    if ( p->layout == LAYOUT_HILBERT ){
+        neighbours = ArenaAlloc( memory, p->n*2*p->dim*sizeof(uint32_t) );
+        assert( neighbours != NULL );
+        NeighbourTable( p, curve, OrderTable( ORDER_ORDER, p->layout, p->dim, extent ), neighbours );
+        sweep = Sweep_Layout;
+    }
+
+    for ( int a=chain->header.bins; a<bins_number; a++ ){
+        for ( int b=0; b<p->bins_size; b++ ){
+            CountersPhase( count, PHASE_SWEEP );
+            long accepted = sweep( sigma, table, neighbours, boltzmann, r, p->order == ORDER_RANDOM, p->dim, p->size );
+            CountersPhase( count, PHASE_MEASURE );
+            TelemetrySweep( status, 1, accepted, count );
+            for ( long s=0; s<p->n; s++ ){
+                view[curve[s]] = sigma[s];
+            }
+            Measure( p, view, fft, statistics->bin );
+            if ( p->series ){
+                long sums[SERIES_SUMS];
+                ObservableSums( p, view, 0, p->size, sums );
+                SeriesRecord( history, p->n, sums );
+            }
+        }
+        CountersPhase( count, PHASE_REDUCE );
+        StatsCloseBin( statistics );
+        TelemetryBin( status, a+1 );
+        CheckpointBin( chain, a == bins_number-1 );
+    }
+}
+
+void Run_Halo( const parameters *p, int bins_number, spin sigma[], const double boltzmann[], rng *r, fft_plan *fft, stats *statistics, series *history, checkpoint *chain, counters *count, telemetry *status, arena *memory ){
+    // run the metropolis algorithm on a lattice with halos; the sites are visited and the random numbers drawn as
+    // in the row layout, so the chain is the same; the direct correlation is summed on the padded lattice, which is
+    // copied back to row-major order (sigma) only for the fft, the time series and the checkpoints
+    halo pad;
+    HaloInit( &pad, p->dim, p->size, p->separation );
+    int extent[MAX_DIM] = { p->size, p->size, p->size };
+    const uint32_t *row = OrderTable( p->order == ORDER_RANDOM ? ORDER_ORDER : p->order, LAYOUT_ROW, p->dim, extent );
+    uint32_t *table = ArenaAlloc( memory, p->n*sizeof(uint32_t) );
+    assert( table != NULL );
+    for ( long c=0; c<p->n; c++ ){
+        table[c] = HaloPosition( &pad, row[c], p->dim, p->size );
+    }
+    spin *padded = ArenaAlloc( memory, pad.stride[p->dim]*sizeof(spin) );
+    assert( padded != NULL );
+    HaloFill( &pad, sigma, padded, p->dim, p->size );
+    halo_sweep_function sweep = FindKernel( p->dim, p->size ).halo;
+
+    for ( int a=chain->header.bins; a<bins_number; a++ ){
+        for ( int b=0; b<p->bins_size; b++ ){
+            CountersPhase( count, PHASE_SWEEP );
+            long accepted = sweep( padded, table, &pad, boltzmann, r, p->order == ORDER_RANDOM, p->dim, p->size );
+            CountersPhase( count, PHASE_MEASURE );
+            TelemetrySweep( status, 1, accepted, count );
+            if ( p->measure == MEASURE_FFT || p->series ){
+                HaloRow( &pad, padded, sigma, p->dim, p->size );
+            }
+            if ( p->measure == MEASURE_FFT ){
+                Correlation_FFT( p, sigma, fft, statistics->bin );
+            }
+            else{
+                Correlation_Halo( p, &pad, padded, statistics->bin );
+            }
+            if ( p->series ){
+                long sums[SERIES_SUMS];
+                ObservableSums( p, sigma, 0, p->size, sums );
+                SeriesRecord( history, p->n, sums );
+            }
+        }
+        CountersPhase( count, PHASE_REDUCE );
+        StatsCloseBin( statistics );
+        TelemetryBin( status, a+1 );
+        if ( CheckpointDue( chain, a == bins_number-1 ) ){
+            HaloRow( &pad, padded, sigma, p->dim, p->size );
+            CheckpointWrite( chain );
+        }
+    }
+}
+
+int RunTables( const parameters *p ){
+    // build the order table a run visits its sites through before it starts, so the tables looked up during the
+    // run are found in the cache; return 1 if it cannot be mapped; the random order walks a curve or the halo
+    // lattice through the table of the plain order
+    if ( p->order == ORDER_CHECKERBOARD || p->order == ORDER_SWENDSEN_WANG ){
+        return 0;
+    }
+    int order = p->order == ORDER_RANDOM && p->layout != LAYOUT_ROW ? ORDER_ORDER : p->order;
+    int layout = p->layout == LAYOUT_HALO ? LAYOUT_ROW : p->layout;
+    int extent[MAX_DIM] = { p->size, p->size, p->size };
+    return TableOrder( order ) && OrderTable( order, layout, p->dim, extent ) == NULL;
+}
+
+void RunFailed( const parameters *p, double avg[], double standard_deviation[] ){
+    // results of a run that could not be done; the other replicas of its ensemble are told not to start
+    if ( p->replicas != NULL ){
+        EnsembleJoin( p->replicas, p->slot, NULL, 0, NULL, 0, -1 );
+    }
+    for ( int d=0; d<p->separation; d++ ){
+        avg[d] = NAN;
+        standard_deviation[d] = NAN;
+    }
+}
+
+void Run( const parameters *p, int bins_number, double avg[], double standard_deviation[], analysis *result, counts *events, telemetry *status ){
+    // run the metropolis algorithm in the update order of the parameters, find avg. and s.d., the cpu time and,
+    // if the series is recorded, the autocorrelation of the observables; all memory of the run comes from one arena;
+    // a resumed run starts from its checkpoint; the hardware events of the run go to events if they are counted,
+    // its progress to status if it is watched; a replica of an ensemble swaps its configuration with its neighbours
+    // in temperature every p->tempering sweeps
+    CountsClear( events );
+    if ( !p->telemetry ){
+        status = NULL;
+    }
+    checkpoint chain;
+    memset( &chain, 0, sizeof(chain) );
+    chain.start = CpuSeconds();
+    result->cpu_seconds = NAN;
+    for ( int o=0; o<OBSERVABLES; o++ ){
+        result->observables[o] = (autocorrelation){ NAN, NAN, NAN, 0, NAN, NAN };
+    }
+    if ( RunTables( p ) ){
+        printf( "Cannot map the order table of a %dD lattice of size %d\n", p->dim, p->size );
+        RunFailed( p, avg, standard_deviation );
+        return;
+    }
+    arena memory;
+    if ( ArenaInit( &memory, JobBytes( p, bins_number ), p->pages ) ){
+        printf( "Cannot allocate %zu bytes for a %dD lattice of size %d\n", JobBytes( p, bins_number ), p->dim, p->size );
+        RunFailed( p, avg, standard_deviation );
+        return;
+    }
+
+    rng r;
+    RandomStream( &r, p->seed, StreamId( p->job, 0 ) );
+
+    spin *sigma = ArenaAlloc( &memory, p->n*sizeof(spin) );
+    assert( sigma != NULL );
+    InitialiseSigma( p, sigma, &r );
+
+    nfold fold;
+    if ( p->order == ORDER_NFOLD ){
+        fold.sites = ArenaAlloc( &memory, p->n*sizeof(uint32_t) );
+        fold.position = ArenaAlloc( &memory, p->n*sizeof(uint32_t) );
+        fold.aligned = ArenaAlloc( &memory, p->n );
+        assert( fold.sites != NULL && fold.position != NULL && fold.aligned != NULL );
+    }
+
+    rng *streams = NULL;
+    int streams_number = p->order == ORDER_CHECKERBOARD || p->order == ORDER_SWENDSEN_WANG ? p->size : 0;
+    if ( streams_number > 0 ){
+        streams = ArenaAlloc( &memory, streams_number*sizeof(rng) );
+        assert( streams != NULL );
+        for ( int layer=0; layer<streams_number; layer++ ){
+            RandomStream( &streams[layer], p->seed, StreamId( p->job, 1+layer ) );
+        }
+    }
+
+    series history;
+    SeriesInit( &history, p->series ? (long)bins_number*p->bins_size : 0, &memory );
+
+    if ( p->checkpoint != NULL ){
+        snprintf( chain.name, sizeof(chain.name), "%s_%ld.ckpt", p->checkpoint, p->job );
+    }
+    chain.every = p->checkpoint_every;
+    chain.header = (checkpoint_header){ .dim = p->dim, .size = p->size, .order = p->order, .measure = p->measure,
+                                        .layout = p->layout, .bins_size = p->bins_size, .separation = p->separation,
+                                        .replica = p->replica, .series = p->series, .tempering = p->tempering,
+                                        .job = p->job, .seed = p->seed, .beta = p->beta, .streams = streams_number };
+    int resumed = CheckpointOpen( &chain, p->resume, bins_number );
+    if ( resumed < 0 ){
+        RunFailed( p, avg, standard_deviation );
+        ArenaFree( &memory );
+        return;
+    }
+
+    char spill[FILENAME_MAX];
+    if ( p->spill != NULL ){
+        snprintf( spill, sizeof(spill), "%s_%ld.csv", p->spill, p->job );
+    }
+    stats statistics;
+    if ( StatsInit( &statistics, p->separation, &memory, p->spill != NULL ? spill : NULL, resumed ? chain.header.spill_position : -1,
+                    p->binary, p->bins_offset ) ){
+        RunFailed( p, avg, standard_deviation );
+        ArenaFree( &memory );
+        return;
+    }
+
+    chain.n = p->n*sizeof(spin);
+    chain.lattice = sigma;
+    chain.r = &r;
+    chain.streams = streams;
+    chain.sites = p->order == ORDER_NFOLD ? fold.sites : NULL;
+    chain.statistics = &statistics;
+    chain.history = &history;
+    if ( resumed && CheckpointRead( &chain, sigma ) ){
+        RunFailed( p, avg, standard_deviation );
+        StatsFree( &statistics );
+        ArenaFree( &memory );
+        return;
+    }
+
+    double boltzmann[4*MAX_DIM+1];
+    BoltzmannTable( p, boltzmann );
+
+    fft_plan fft;
+    if ( p->measure == MEASURE_FFT ){
+        FFTInit( &fft, p->dim, p->size, &memory );
+    }
+
+    // the counters cover the bins run here, from the first sweep to the analysis
+    counters count;
+    CountersOpen( &count, p->counters || p->telemetry, p->counters );
+    TelemetryBin( status, chain.header.bins );
+    double updates = (double)(bins_number-chain.header.bins)*p->bins_size*p->n;
+    if ( p->order == ORDER_CHECKERBOARD || p->order == ORDER_SWENDSEN_WANG ){
+        chain.helpers = Run_Slabs( p, bins_number, sigma, boltzmann, streams, &fft, &statistics, &history, &chain, &count, status, &memory );
+    }
+    else if ( p->layout == LAYOUT_HALO ){
+        Run_Halo( p, bins_number, sigma, boltzmann, &r, &fft, &statistics, &history, &chain, &count, status, &memory );
+    }
+    else if ( p->layout != LAYOUT_ROW ){
+        Run_Layout( p, bins_number, sigma, boltzmann, &r, &fft, &statistics, &history, &chain, &count, status, &memory );
+    }
+    else{
+        int extent[MAX_DIM] = { p->size, p->size, p->size };
+        const uint32_t *table = OrderTable( p->order, LAYOUT_ROW, p->dim, extent );
+
+        long *sums = NULL;
+        if ( p->measure == MEASURE_INCREMENTAL ){
+            sums = ArenaAlloc( &memory, p->separation*sizeof(long) );
+            assert( sums != NULL );
+            CorrelationSums_Axes( p, sigma, 0, p->size, sums );
+        }
+
+        kernel k = FindKernel( p->dim, p->size );
+        sweep_function sweep = p->order == ORDER_RANDOM ? k.random : k.table;
+        uint32_t *stack = NULL;
+        if ( p->order == ORDER_WOLFF ){
+            stack = ArenaAlloc( &memory, p->n*sizeof(uint32_t) );
+            assert( stack != NULL );
+            if ( !resumed ){
+                chain.header.clusters = WolffClusters( k.cluster, sigma, stack, boltzmann, &r, sums, p->separation, p->dim, p->size );
+            }
+        }
+        if ( p->order == ORDER_NFOLD ){
+            NFoldInit( &fold, sigma, p->dim, p->size, resumed );
+        }
+        // the field is of the lattice the chain starts (or resumes) from, the chain is the same as without it
+        signed char *field = NULL;
+        if ( p->field && !AlgorithmOrder( p->order ) ){
+            field = ArenaAlloc( &memory, p->n );
+            assert( field != NULL );
+            FieldInit( field, sigma, p->dim, p->size );
+        }
+        // the replicas of an ensemble start together, or not at all if one of them cannot
+        ensemble *replicas = p->replicas;
+        if ( replicas != NULL && !EnsembleJoin( replicas, p->slot, sigma, p->n*sizeof(spin), sums, p->separation, chain.header.bins ) ){
+            for ( int d=0; d<p->separation; d++ ){
+                avg[d] = NAN;
+                standard_deviation[d] = NAN;
+            }
+            CountersClose( &count );
+            StatsFree( &statistics );
+            ArenaFree( &memory );
+            return;
+        }
+        for ( int a=chain.header.bins; a<bins_number; a++ ){
+            for ( int b=0; b<p->bins_size; b++ ){
+                CountersPhase( &count, PHASE_SWEEP );
+                long accepted;
+                if ( p->order == ORDER_WOLFF ){
+                    accepted = k.cluster( sigma, stack, boltzmann, &r, sums, p->separation, chain.header.clusters, p->dim, p->size );
+                }
+                else if ( p->order == ORDER_NFOLD ){
+                    accepted = k.nfold( sigma, &fold, boltzmann, &r, sums, p->separation, p->dim, p->size );
+                }
+                else if ( field != NULL ){
+                    accepted = k.field( sigma, field, table, boltzmann, &r, sums, p->separation, p->order == ORDER_RANDOM, p->dim, p->size );
+                }
+                else{
+                    accepted = sweep( sigma, table, boltzmann, &r, sums, p->separation, p->dim, p->size );
+                }
+                long number = (long)a*p->bins_size+b+1; // sweeps of the chain
+                if ( replicas != NULL && number%p->tempering == 0 ){
+                    CountersPhase( &count, PHASE_REDUCE );
+                    long energy[SERIES_SUMS];
+                    ObservableSums( p, sigma, 0, p->size, energy );
+                    if ( EnsembleExchange( replicas, p->slot, -(double)energy[1], number/p->tempering ) ){
+                        if ( p->order == ORDER_NFOLD ){
+                            NFoldInit( &fold, sigma, p->dim, p->size, 0 );
+                        }
+                        if ( field != NULL ){
+                            FieldInit( field, sigma, p->dim, p->size );
+                        }
+                    }
+                }
+                CountersPhase( &count, PHASE_MEASURE );
+                TelemetrySweep( status, 1, accepted, &count );
+                if ( p->measure == MEASURE_INCREMENTAL ){
+                    Correlation_Incremental( p, sums, statistics.bin );
+                }
+                else{
+                    Measure( p, sigma, &fft, statistics.bin );
+                }
+                if ( p->series ){
+                    long observables[SERIES_SUMS];
+                    ObservableSums( p, sigma, 0, p->size, observables );
+                    SeriesRecord( &history, p->n, observables );
+                }
+            }
+            CountersPhase( &count, PHASE_REDUCE );
+            StatsCloseBin( &statistics );
+            TelemetryBin( status, a+1 );
+            if ( replicas != NULL && chain.name[0] != 0 ){
+                if ( EnsembleCheckpoint( replicas, p->slot, CheckpointDue( &chain, a == bins_number-1 ) ) ){
+                    CheckpointWrite( &chain );
+                }
+            }
+            else{
+                CheckpointBin( &chain, a == bins_number-1 );
+            }
+        }
+    }
+
+    CountersPhase( &count, PHASE_REDUCE );
+    StatsResult( &statistics, avg, standard_deviation );
+    StatsFree( &statistics );
+    result->cpu_seconds = ChainSeconds( &chain );
+    if ( p->series ){
+        Analyse( &history, result );
+    }
+    CountersClose( &count );
+    *events = count.total;
+    events->updates = updates;
+    ArenaFree( &memory );
+}
@@ -0,0 +1,492 @@
+// this file needs to be in the same directory as the main file
+// update orders: tables of the sites in the order they are updated, computed once per lattice and shared read-only
+// by all threads and repetitions; Morton, Hilbert and Gcurve positions are found in closed form from the bits of the
+// step number, lattices whose size is not a power of 2 use the generalized Hilbert curve or skip the sites outside;
+// the lattice itself may be stored along the Morton or Hilbert curve, the tables then hold storage positions, or row
+// by row with halos of ghost sites (IMND_Functions.h)
+
+#define MAX_DIM 3 // highest dimension of the lattice
+
+// update orders, the names are used on the command line and in the csv columns; wolff (single cluster) and
+// swendsen-wang (all clusters, in parallel) are cluster algorithms in place of single-site updates, nfold the
+// rejection-free n-fold way, all three run only when asked for
+enum{ ORDER_RANDOM, ORDER_ORDER, ORDER_2ND, ORDER_3RD, ORDER_HILBERT, ORDER_LEBESGUE, ORDER_GCURVE, ORDER_CHECKERBOARD, ORDER_WOLFF,
+      ORDER_SWENDSEN_WANG, ORDER_NFOLD, ORDERS };
+const char *ORDER_NAMES[ORDERS] = { "random", "order", "2nd", "3rd", "hilbert", "lebesgue", "gcurve", "checkerboard", "wolff",
+                                    "swendsen-wang", "nfold" };
+
+// storage layouts of the lattice: row-major, along the curve of the order LAYOUT_CURVE, or row-major padded with
+// ghost copies of the opposite faces
+enum{ LAYOUT_ROW, LAYOUT_MORTON, LAYOUT_HILBERT, LAYOUT_HALO, LAYOUTS };
+const char *LAYOUT_NAMES[LAYOUTS] = { "row", "morton", "hilbert", "halo" };
+const int LAYOUT_CURVE[LAYOUTS] = { ORDER_ORDER, ORDER_LEBESGUE, ORDER_HILBERT, ORDER_ORDER };
+
+// bits of a Morton number belonging to each axis, x in the lowest bit of each group; 64 bits, since the Morton curve
+// of the enclosing power of 2 of a lattice of up to 2^32-1 sites can run past 2^32 (a 3D size above 1024 needs 11
+// bits per axis)
+const uint64_t MORTON_MASK[MAX_DIM+1][MAX_DIM] = {
+    { 0, 0, 0 },
+    { 0xFFFFFFFFFFFFFFFFULL, 0, 0 },
+    { 0x5555555555555555ULL, 0xAAAAAAAAAAAAAAAAULL, 0 },
+    { 0x9249249249249249ULL, 0x2492492492492492ULL, 0x4924924924924924ULL }
+};
+
+// a table already built for one lattice
+typedef struct order_cache{
+    int order;
+    int layout;
+    int dim;
+    int extent[MAX_DIM];
+    size_t bytes; // mapped size of the table
+    uint32_t *table;
+    struct order_cache *next;
+} order_cache;
+
+order_cache *ORDER_TABLES = NULL;
+pthread_mutex_t ORDER_LOCK = PTHREAD_MUTEX_INITIALIZER;
+
+
+int ParseOrder( const char *name );
+int OrderSupported( int order, int dim, int size );
+int AlgorithmOrder( int order );
+int TableOrder( int order );
+int ParseLayout( const char *name );
+int LayoutSupported( int layout, int order, int dim, int size );
+int ChoosePosition_2ND( long c, long n );
+int ChoosePosition_3RD( long c, long n );
+static inline uint64_t ExtractBits( uint64_t value, uint64_t mask );
+int CeilLog2( int size );
+long SiteIndex( int dim, const int extent[], const int x[] );
+int FloorHalf( int a );
+int Sign( int a );
+void MortonPoint( uint64_t k, int dim, int x[] );
+void HilbertPoint( uint32_t k, int dim, int bits, int x[] );
+void GcurvePoint( uint32_t k, int levels, int x[] );
+void Gilbert2D( int x, int y, int ax, int ay, int bx, int by, const int extent[], uint32_t table[], long *count );
+void Gilbert3D( int x, int y, int z, int ax, int ay, int az, int bx, int by, int bz, int cx, int cy, int cz, const int extent[], uint32_t table[], long *count );
+void BuildOrder( int order, int dim, const int extent[], uint32_t table[] );
+const uint32_t *OrderTable( int order, int layout, int dim, const int extent[] );
+void FreeOrderTables( void );
+
+
+int ParseOrder( const char *name ){
+    // return the update order with the given name, or -1
+    for ( int order=0; order<ORDERS; order++ ){
+        if ( strcmp( name, ORDER_NAMES[order] ) == 0 ){
+            return order;
+        }
+    }
+    return -1;
+}
+
+int OrderSupported( int order, int dim, int size ){
+    // return 1 if the update order can be used for the lattice, otherwise 0
+    switch ( order ){
+        case ORDER_HILBERT:
+            return dim == 2 || dim == 3;
+        case ORDER_GCURVE:
+            return dim == 2;
+        case ORDER_CHECKERBOARD:
+            return size%2 == 0;
+        default:
+            return 1;
+    }
+}
+
+int AlgorithmOrder( int order ){
+    // return 1 for the algorithms run in place of the metropolis sweep (clusters, n-fold way), otherwise 0
+    return order == ORDER_WOLFF || order == ORDER_SWENDSEN_WANG || order == ORDER_NFOLD;
+}
+
+int TableOrder( int order ){
+    // return 1 for the orders that visit the sites through a table of OrderTable, otherwise 0
+    return order != ORDER_RANDOM && order != ORDER_CHECKERBOARD && !AlgorithmOrder( order );
+}
+
+int ParseLayout( const char *name ){
+    // return the storage layout with the given name, or -1
+    for ( int layout=0; layout<LAYOUTS; layout++ ){
+        if ( strcmp( name, LAYOUT_NAMES[layout] ) == 0 ){
+            return layout;
+        }
+    }
+    return -1;
+}
+
+int LayoutSupported( int layout, int order, int dim, int size ){
+    // return 1 if the lattice can be stored in the layout and swept in the update order, otherwise 0;
+    // Morton neighbours wrap around by dilated arithmetic only on a power of 2, the checkerboard needs whole rows,
+    // clusters grow and the n-fold way keeps its classes on the row-major lattice
+    switch ( layout ){
+        case LAYOUT_HALO:
+            return order != ORDER_CHECKERBOARD && !AlgorithmOrder( order );
+        case LAYOUT_MORTON:
+            return (size & (size-1)) == 0 && order != ORDER_CHECKERBOARD && !AlgorithmOrder( order );
+        case LAYOUT_HILBERT:
+            return OrderSupported( ORDER_HILBERT, dim, size ) && order != ORDER_CHECKERBOARD && !AlgorithmOrder( order );
+        default:
+            return 1;
+    }
+}
+
+int ChoosePosition_2ND( long c, long n ){
+    // return the c-th site from 0 going every second site
+    if ( 2*c < n ){
+        return 2*c;
+    }
+    else if ( n%2 == 0 ){
+        return 2*c-n+1;
+    }
+    else{
+        return 2*c-n;
+    }
+}
+
+int ChoosePosition_3RD( long c, long n ){
+    // return the c-th site from 0 going every third site
+    if ( 3*c < n ){
+        return 3*c;
+    }
+    else if ( n%3 == 0 ){
+        return 3*c < 2*n ? 3*c-n+1 : 3*c-2*n+2;
+    }
+    else if ( n%3 == 1 ){
+        return 3*c-n-1 < n ? 3*c-n-1 : 3*c-2*n+1;
+    }
+    else{
+        return 3*c-n < n ? 3*c-n : 3*c-2*n;
+    }
+}
+
+static inline uint64_t ExtractBits( uint64_t value, uint64_t mask ){
+    // gather the bits of value selected by mask into the low bits (pext)
+#ifdef __BMI2__
+    return _pext_u64( value, mask );
+#else
+    uint64_t result = 0;
+    for ( uint64_t bit=1; mask!=0; bit<<=1 ){
+        if ( value & mask & -mask ){
+            result |= bit;
+        }
+        mask &= mask-1;
+    }
+    return result;
+#endif
+}
+
+int CeilLog2( int size ){
+    // return the number of bits needed for the coordinates 0 to size-1
+    int bits = 0;
+    while ( (1 << bits) < size ){
+        bits++;
+    }
+    return bits;
+}
+
+long SiteIndex( int dim, const int extent[], const int x[] ){
+    // return the linear index of the site at x, or -1 if it lies outside the lattice
+    long i = 0;
+    for ( int axis=dim-1; axis>=0; axis-- ){
+        if ( x[axis] >= extent[axis] ){
+            return -1;
+        }
+        i = i*extent[axis] + x[axis];
+    }
+    return i;
+}
+
+void MortonPoint( uint64_t k, int dim, int x[] ){
+    // coordinates of the k-th site of the Morton (Lebesgue) curve: every dim-th bit of k belongs to one axis
+    for ( int axis=0; axis<dim; axis++ ){
+        x[axis] = ExtractBits( k, MORTON_MASK[dim][axis] );
+    }
+}
+
+void HilbertPoint( uint32_t k, int dim, int bits, int x[] ){
+    // coordinates of the k-th site of the Hilbert curve in a cube of side 2^bits (Skilling's transform)
+    for ( int axis=0; axis<dim; axis++ ){
+        x[axis] = ExtractBits( k, MORTON_MASK[dim][dim-1-axis] );
+    }
+
+    // Gray decode
+    int t = x[dim-1] >> 1;
+    for ( int axis=dim-1; axis>0; axis-- ){
+        x[axis] ^= x[axis-1];
+    }
+    x[0] ^= t;
+
+    // undo the excess rotations and reflections
+    for ( int q=2; q!=(1 << bits) && bits>0; q<<=1 ){
+        int p = q-1;
+        for ( int axis=dim-1; axis>=0; axis-- ){
+            if ( x[axis] & q ){
+                x[0] ^= p;
+            }
+            else{
+                t = (x[0] ^ x[axis]) & p;
+                x[0] ^= t;
+                x[axis] ^= t;
+            }
+        }
+    }
+}
+
+void GcurvePoint( uint32_t k, int levels, int x[] ){
+    // coordinates of the k-th site of the Gcurve in a square of side 4^levels: each base 16 digit of k picks
+    // one of the 16 sub-squares visited by the curve
+    const int path[16][2] = { {0,0}, {0,1}, {0,2}, {0,3}, {1,3}, {2,3}, {3,3}, {3,2}, {2,2}, {1,2}, {1,1}, {1,0}, {2,0}, {2,1}, {3,1}, {3,0} };
+    x[0] = 0;
+    x[1] = 0;
+    for ( int level=levels-1; level>=0; level-- ){
+        int digit = (k >> 4*level) & 15;
+        x[0] = 4*x[0] + path[digit][0];
+        x[1] = 4*x[1] + path[digit][1];
+    }
+}
+
+int FloorHalf( int a ){
+    // return a/2 rounded down, also for negative a
+    return a >= 0 ? a/2 : -((1-a)/2);
+}
+
+int Sign( int a ){
+    // return the sign of a
+    return (a > 0) - (a < 0);
+}
+
+void Gilbert2D( int x, int y, int ax, int ay, int bx, int by, const int extent[], uint32_t table[], long *count ){
+    // add the sites of the generalized Hilbert curve in the rectangle at (x, y) spanned by a and b to the table
+    int w = abs( ax+ay ), h = abs( bx+by );
+    int dax = Sign( ax ), day = Sign( ay ), dbx = Sign( bx ), dby = Sign( by );
+
+    if ( h == 1 || w == 1 ){
+        int steps = h == 1 ? w : h;
+        int dx = h == 1 ? dax : dbx, dy = h == 1 ? day : dby;
+        for ( int k=0; k<steps; k++ ){
+            table[(*count)++] = x + (long)extent[0]*y;
+            x += dx;
+            y += dy;
+        }
+        return;
+    }
+
+    int ax2 = FloorHalf( ax ), ay2 = FloorHalf( ay ), bx2 = FloorHalf( bx ), by2 = FloorHalf( by );
+    int w2 = abs( ax2+ay2 ), h2 = abs( bx2+by2 );
+
+    if ( 2*w > 3*h ){
+        // long rectangle: split in two along a
+        if ( w2%2 && w > 2 ){
+            ax2 += dax;
+            ay2 += day;
+        }
+        Gilbert2D( x, y, ax2, ay2, bx, by, extent, table, count );
+        Gilbert2D( x+ax2, y+ay2, ax-ax2, ay-ay2, bx, by, extent, table, count );
+    }
+    else{
+        // split in three: up along b, across along a, down along b
+        if ( h2%2 && h > 2 ){
+            bx2 += dbx;
+            by2 += dby;
+        }
+        Gilbert2D( x, y, bx2, by2, ax2, ay2, extent, table, count );
+        Gilbert2D( x+bx2, y+by2, ax, ay, bx-bx2, by-by2, extent, table, count );
+        Gilbert2D( x+(ax-dax)+(bx2-dbx), y+(ay-day)+(by2-dby), -bx2, -by2, -(ax-ax2), -(ay-ay2), extent, table, count );
+    }
+}
+
+void Gilbert3D( int x, int y, int z, int ax, int ay, int az, int bx, int by, int bz, int cx, int cy, int cz, const int extent[], uint32_t table[], long *count ){
+    // add the sites of the generalized Hilbert curve in the box at (x, y, z) spanned by a, b and c to the table
+    int w = abs( ax+ay+az ), h = abs( bx+by+bz ), d = abs( cx+cy+cz );
+    int dax = Sign( ax ), day = Sign( ay ), daz = Sign( az );
+    int dbx = Sign( bx ), dby = Sign( by ), dbz = Sign( bz );
+    int dcx = Sign( cx ), dcy = Sign( cy ), dcz = Sign( cz );
+
+    if ( (h == 1 && d == 1) || (w == 1 && d == 1) || (w == 1 && h == 1) ){
+        int steps = w*h*d;
+        int dx = w > 1 ? dax : h > 1 ? dbx : dcx;
+        int dy = w > 1 ? day : h > 1 ? dby : dcy;
+        int dz = w > 1 ? daz : h > 1 ? dbz : dcz;
+        for ( int k=0; k<steps; k++ ){
+            table[(*count)++] = x + (long)extent[0]*(y + (long)extent[1]*z);
+            x += dx;
+            y += dy;
+            z += dz;
+        }
+        return;
+    }
+
+    int ax2 = FloorHalf( ax ), ay2 = FloorHalf( ay ), az2 = FloorHalf( az );
+    int bx2 = FloorHalf( bx ), by2 = FloorHalf( by ), bz2 = FloorHalf( bz );
+    int cx2 = FloorHalf( cx ), cy2 = FloorHalf( cy ), cz2 = FloorHalf( cz );
+    int w2 = abs( ax2+ay2+az2 ), h2 = abs( bx2+by2+bz2 ), d2 = abs( cx2+cy2+cz2 );
+
+    // prefer even steps
+    if ( w2%2 && w > 2 ){ ax2 += dax; ay2 += day; az2 += daz; }
+    if ( h2%2 && h > 2 ){ bx2 += dbx; by2 += dby; bz2 += dbz; }
+    if ( d2%2 && d > 2 ){ cx2 += dcx; cy2 += dcy; cz2 += dcz; }
+
+    if ( 2*w > 3*h && 2*w > 3*d ){
+        // wide box: split along a only
+        Gilbert3D( x, y, z, ax2, ay2, az2, bx, by, bz, cx, cy, cz, extent, table, count );
+        Gilbert3D( x+ax2, y+ay2, z+az2, ax-ax2, ay-ay2, az-az2, bx, by, bz, cx, cy, cz, extent, table, count );
+    }
+    else if ( 3*h > 4*d ){
+        // do not split along c
+        Gilbert3D( x, y, z, bx2, by2, bz2, cx, cy, cz, ax2, ay2, az2, extent, table, count );
+        Gilbert3D( x+bx2, y+by2, z+bz2, ax, ay, az, bx-bx2, by-by2, bz-bz2, cx, cy, cz, extent, table, count );
+        Gilbert3D( x+(ax-dax)+(bx2-dbx), y+(ay-day)+(by2-dby), z+(az-daz)+(bz2-dbz), -bx2, -by2, -bz2, cx, cy, cz,
+                   -(ax-ax2), -(ay-ay2), -(az-az2), extent, table, count );
+    }
+    else if ( 3*d > 4*h ){
+        // do not split along b
+        Gilbert3D( x, y, z, cx2, cy2, cz2, ax2, ay2, az2, bx, by, bz, extent, table, count );
+        Gilbert3D( x+cx2, y+cy2, z+cz2, ax, ay, az, bx, by, bz, cx-cx2, cy-cy2, cz-cz2, extent, table, count );
+        Gilbert3D( x+(ax-dax)+(cx2-dcx), y+(ay-day)+(cy2-dcy), z+(az-daz)+(cz2-dcz), -cx2, -cy2, -cz2,
+                   -(ax-ax2), -(ay-ay2), -(az-az2), bx, by, bz, extent, table, count );
+    }
+    else{
+        // split along all three
+        Gilbert3D( x, y, z, bx2, by2, bz2, cx2, cy2, cz2, ax2, ay2, az2, extent, table, count );
+        Gilbert3D( x+bx2, y+by2, z+bz2, cx, cy, cz, ax2, ay2, az2, bx-bx2, by-by2, bz-bz2, extent, table, count );
+        Gilbert3D( x+(bx2-dbx)+(cx-dcx), y+(by2-dby)+(cy-dcy), z+(bz2-dbz)+(cz-dcz), ax, ay, az, -bx2, -by2, -bz2,
+                   -(cx-cx2), -(cy-cy2), -(cz-cz2), extent, table, count );
+        Gilbert3D( x+(ax-dax)+bx2+(cx-dcx), y+(ay-day)+by2+(cy-dcy), z+(az-daz)+bz2+(cz-dcz), -cx, -cy, -cz,
+                   -(ax-ax2), -(ay-ay2), -(az-az2), bx-bx2, by-by2, bz-bz2, extent, table, count );
+        Gilbert3D( x+(ax-dax)+(bx2-dbx), y+(ay-day)+(by2-dby), z+(az-daz)+(bz2-dbz), -bx2, -by2, -bz2, cx2, cy2, cz2,
+                   -(ax-ax2), -(ay-ay2), -(az-az2), extent, table, count );
+    }
+}
+
+void BuildOrder( int order, int dim, const int extent[], uint32_t table[] ){
+    // fill the table with the sites of the lattice in the order they are updated
+    long n = 1;
+    int bits = 0, power2 = 1;
+    for ( int axis=0; axis<dim; axis++ ){
+        n *= extent[axis];
+        bits = CeilLog2( extent[axis] ) > bits ? CeilLog2( extent[axis] ) : bits;
+        power2 &= extent[axis] == extent[0] && (extent[axis] & (extent[axis]-1)) == 0;
+    }
+    long count = 0;
+    int x[MAX_DIM];
+
+    switch ( order ){
+        case ORDER_2ND:
+            for ( long c=0; c<n; c++ ){ table[c] = ChoosePosition_2ND( c, n ); }
+            break;
+        case ORDER_3RD:
+            for ( long c=0; c<n; c++ ){ table[c] = ChoosePosition_3RD( c, n ); }
+            break;
+        case ORDER_HILBERT:
+            if ( power2 ){
+                for ( long k=0; k<n; k++ ){
+                    HilbertPoint( k, dim, bits, x );
+                    table[k] = SiteIndex( dim, extent, x );
+                }
+            }
+            else if ( dim == 2 ){
+                if ( extent[0] >= extent[1] ){ Gilbert2D( 0, 0, extent[0], 0, 0, extent[1], extent, table, &count ); }
+                else{ Gilbert2D( 0, 0, 0, extent[1], extent[0], 0, extent, table, &count ); }
+            }
+            else{
+                if ( extent[0] >= extent[1] && extent[0] >= extent[2] ){ Gilbert3D( 0, 0, 0, extent[0], 0, 0, 0, extent[1], 0, 0, 0, extent[2], extent, table, &count ); }
+                else if ( extent[1] >= extent[0] && extent[1] >= extent[2] ){ Gilbert3D( 0, 0, 0, 0, extent[1], 0, extent[0], 0, 0, 0, 0, extent[2], extent, table, &count ); }
+                else{ Gilbert3D( 0, 0, 0, 0, 0, extent[2], extent[0], 0, 0, 0, extent[1], 0, extent, table, &count ); }
+            }
+            break;
+        case ORDER_LEBESGUE:
+            // the Morton curve of the enclosing power of 2, skipping the sites outside the lattice
+            for ( uint64_t k=0; count<n; k++ ){
+                MortonPoint( k, dim, x );
+                long i = SiteIndex( dim, extent, x );
+                if ( i >= 0 ){ table[count++] = i; }
+            }
+            break;
+        case ORDER_GCURVE:
+            // the Gcurve of the enclosing power of 4, skipping the sites outside the lattice
+            for ( uint64_t k=0; count<n; k++ ){
+                GcurvePoint( k, (bits+1)/2, x );
+                long i = SiteIndex( dim, extent, x );
+                if ( i >= 0 ){ table[count++] = i; }
+            }
+            break;
+        default:
+            for ( long c=0; c<n; c++ ){ table[c] = c; }
+            break;
+    }
+}
+
+const uint32_t *OrderTable( int order, int layout, int dim, const int extent[] ){
+    // return the storage positions of the sites in the update order for a lattice in the layout, building the table
+    // on first use; NULL for orders without one or if the table cannot be mapped
+    if ( !TableOrder( order ) ){
+        return NULL;
+    }
+
+    // the tables a layout is built from: the curve of the layout and the storage position of each site
+    const uint32_t *curve = NULL, *position = NULL, *row = NULL;
+    if ( layout != LAYOUT_ROW ){
+        curve = OrderTable( LAYOUT_CURVE[layout], LAYOUT_ROW, dim, extent );
+        if ( order != ORDER_ORDER ){
+            position = OrderTable( ORDER_ORDER, layout, dim, extent );
+            row = OrderTable( order, LAYOUT_ROW, dim, extent );
+        }
+        if ( curve == NULL || (order != ORDER_ORDER && (position == NULL || row == NULL)) ){
+            return NULL;
+        }
+    }
+
+    pthread_mutex_lock( &ORDER_LOCK );
+    order_cache *c;
+    for ( c=ORDER_TABLES; c!=NULL; c=c->next ){
+        int same = c->order == order && c->layout == layout && c->dim == dim;
+        for ( int axis=0; axis<dim; axis++ ){
+            same &= c->extent[axis] == extent[axis];
+        }
+        if ( same ){
+            break;
+        }
+    }
+    if ( c == NULL ){
+        long n = 1;
+        c = malloc( sizeof(order_cache) );
+        c->order = order;
+        c->layout = layout;
+        c->dim = dim;
+        for ( int axis=0; axis<dim; axis++ ){
+            c->extent[axis] = extent[axis];
+            n *= extent[axis];
+        }
+        c->bytes = (n*sizeof(uint32_t) + HUGE_PAGE-1)/HUGE_PAGE*HUGE_PAGE;
+        c->table = MapPages( c->bytes, PAGES_TRANSPARENT );
+        if ( c->table == NULL ){
+            free( c );
+            pthread_mutex_unlock( &ORDER_LOCK );
+            return NULL;
+        }
+        if ( layout == LAYOUT_ROW ){
+            BuildOrder( order, dim, extent, c->table );
+        }
+        else if ( order == ORDER_ORDER ){
+            for ( long k=0; k<n; k++ ){ c->table[curve[k]] = k; }
+        }
+        else{
+            for ( long k=0; k<n; k++ ){ c->table[k] = position[row[k]]; }
+        }
+        c->next = ORDER_TABLES;
+        ORDER_TABLES = c;
+    }
+    pthread_mutex_unlock( &ORDER_LOCK );
+    return c->table;
+}
+
+void FreeOrderTables( void ){
+    // free all tables built so far
+    pthread_mutex_lock( &ORDER_LOCK );
+    while ( ORDER_TABLES != NULL ){
+        order_cache *next = ORDER_TABLES->next;
+        munmap( ORDER_TABLES->table, ORDER_TABLES->bytes );
+        free( ORDER_TABLES );
+        ORDER_TABLES = next;
+    }
+    pthread_mutex_unlock( &ORDER_LOCK );
+}
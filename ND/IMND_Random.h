@@ -0,0 +1,124 @@
+// this file needs to be in the same directory as the main file
+// counter-based random numbers (Philox4x32-10): the n-th block of a stream is a pure function of the seed,
+// the stream number and n, so every job of a parameter sweep and every lattice layer gets its own reproducible stream
+
+#define RANDOM_BLOCK 256 // random numbers generated at a time by a stream
+
+// one stream of random numbers: counter = (block, stream), key = seed
+typedef struct{
+    uint32_t key[2];
+    uint32_t stream[2];
+    uint64_t block; // counter of the next block of four numbers
+    int index; // next unused number of the buffer
+    uint32_t buffer[RANDOM_BLOCK];
+} rng;
+
+
+void Philox( const uint32_t counter[4], const uint32_t key[2], uint32_t out[4] );
+void RandomFill( const uint32_t key[2], const uint32_t stream[2], uint64_t block, long count, uint32_t out[] );
+void RandomFill_Uniform( rng *r, double out[], long count );
+void RandomRefill( rng *r );
+uint64_t StreamId( long job, int lane );
+void RandomStream( rng *r, uint64_t seed, uint64_t stream );
+static inline uint32_t Random32( rng *r );
+static inline double RandomUniform( rng *r );
+static inline uint32_t RandomBelow( rng *r, uint32_t n );
+
+
+void Philox( const uint32_t counter[4], const uint32_t key[2], uint32_t out[4] ){
+    // ten rounds of Philox4x32 on one counter
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+
+    for ( int round=0; round<10; round++ ){
+        uint64_t product0 = (uint64_t)0xD2511F53 * c0;
+        uint64_t product1 = (uint64_t)0xCD9E8D57 * c2;
+        uint32_t n0 = (uint32_t)(product1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = (uint32_t)(product0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t)product1;
+        c3 = (uint32_t)product0;
+        c0 = n0;
+        c2 = n2;
+        k0 += 0x9E3779B9;
+        k1 += 0xBB67AE85;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+void RandomFill( const uint32_t key[2], const uint32_t stream[2], uint64_t block, long count, uint32_t out[] ){
+    // write the blocks block, block+1, ... of a stream to out (count is a multiple of 4);
+    // the blocks are independent, so the loop vectorises
+    for ( long b=0; b<count/4; b++ ){
+        uint32_t counter[4] = { (uint32_t)(block+b), (uint32_t)((block+b) >> 32), stream[0], stream[1] };
+        Philox( counter, key, &out[4*b] );
+    }
+}
+
+void RandomFill_Uniform( rng *r, double out[], long count ){
+    // write count uniform random numbers in [0, 1) to out, converted a whole buffer at a time
+    long i = 0;
+    while ( i < count ){
+        if ( r->index == RANDOM_BLOCK ){
+            RandomRefill( r );
+        }
+        long batch = RANDOM_BLOCK - r->index;
+        if ( batch > count-i ){
+            batch = count-i;
+        }
+        for ( long j=0; j<batch; j++ ){
+            out[i+j] = r->buffer[r->index+j]*(1.0/4294967296.0);
+        }
+        r->index += batch;
+        i += batch;
+    }
+}
+
+void RandomRefill( rng *r ){
+    // generate the next RANDOM_BLOCK numbers of the stream
+    RandomFill( r->key, r->stream, r->block, RANDOM_BLOCK, r->buffer );
+    r->block += RANDOM_BLOCK/4;
+    r->index = 0;
+}
+
+uint64_t StreamId( long job, int lane ){
+    // number of the stream used by one lane (0 for the whole lattice, 1+layer for a checkerboard layer) of a job
+    return (uint64_t)job << 32 | (uint32_t)lane;
+}
+
+void RandomStream( rng *r, uint64_t seed, uint64_t stream ){
+    // start a stream at its first block
+    r->key[0] = (uint32_t)seed;
+    r->key[1] = (uint32_t)(seed >> 32);
+    r->stream[0] = (uint32_t)stream;
+    r->stream[1] = (uint32_t)(stream >> 32);
+    r->block = 0;
+    r->index = RANDOM_BLOCK;
+}
+
+static inline uint32_t Random32( rng *r ){
+    // return 32 random bits
+    if ( r->index == RANDOM_BLOCK ){
+        RandomRefill( r );
+    }
+    return r->buffer[r->index++];
+}
+
+static inline double RandomUniform( rng *r ){
+    // return a random number in [0, 1)
+    return Random32( r )*(1.0/4294967296.0);
+}
+
+static inline uint32_t RandomBelow( rng *r, uint32_t n ){
+    // return a random integer in [0, n) without bias (multiply and reject)
+    uint64_t m = (uint64_t)Random32( r )*n;
+    if ( (uint32_t)m < n ){
+        uint32_t threshold = -n % n;
+        while ( (uint32_t)m < threshold ){
+            m = (uint64_t)Random32( r )*n;
+        }
+    }
+    return m >> 32;
+}
@@ -0,0 +1,853 @@
+// this file needs to be in the same directory as the main file
+// parameter sweeps: the grid of dimensions, sizes, temperatures, update orders and repetitions is read from the
+// command line or a config file, and its independent jobs (or ensembles of replicas at all temperatures, or batches
+// of repetitions) are spread over a pool of work-stealing threads
+
+#define MAX_LIST 64 // most values of one parameter in a sweep
+#define JOB_CELLS ((long)MAX_DIM*MAX_LIST*MAX_LIST*ORDERS) // job numbers of one repetition
+#define MAX_REPEATS (((long)UINT32_MAX+1)/JOB_CELLS) // repetitions whose job numbers fit a stream number
+
+// the parameter grid of a sweep
+typedef struct{
+    parameters base; // mcs, bins size, separation, threads, measure, layout, pages, outputs, checkpoints and seed shared by all jobs
+    int dims[MAX_LIST];
+    int dims_number;
+    int sizes[MAX_LIST];
+    int sizes_number;
+    double betas[MAX_LIST];
+    int betas_number;
+    int orders[ORDERS];
+    int orders_number; // 0 runs every order the lattice supports but the cluster algorithms and the n-fold way
+    int repeats;
+    int workers; // threads running jobs at the same time
+    char output[FILENAME_MAX];
+    char spill[FILENAME_MAX]; // prefix of the files of raw bins, empty for none
+    char autocorrelation[FILENAME_MAX]; // output of the autocorrelation analysis, empty for none
+    char binary[FILENAME_MAX]; // binary output of the sweep, empty for none
+    char checkpoint[FILENAME_MAX]; // prefix of the checkpoint files, empty for none
+    char counters[FILENAME_MAX]; // json sidecar of the hardware counters next to the output, empty for none
+    char status[FILENAME_MAX]; // status file rewritten while the sweep runs, empty for none
+    double status_every; // seconds between rewrites of the status file
+} grid;
+
+// one run of the sweep and its results
+typedef struct{
+    parameters p;
+    int bins_number;
+    double *avg;
+    double *standard_deviation;
+    analysis result; // cpu time and autocorrelation of the observables
+    counts events; // hardware events of the sweeps, measurements and reductions
+    telemetry status; // progress while the job runs
+} job;
+
+// jobs of one worker: the owner takes them from the bottom, other workers steal them from the top
+typedef struct{
+    pthread_mutex_t lock;
+    long *jobs;
+    long top;
+    long bottom;
+} deque;
+
+// struct handed to each thread of the pool
+typedef struct{
+    int id;
+    int workers;
+    deque *deques;
+    job *jobs;
+    long jobs_number;
+    long *completed;
+    pthread_mutex_t *progress;
+} worker;
+
+// struct handed to the thread writing the status file
+typedef struct{
+    const char *name;
+    double every;
+    double start; // wall time of the start of the sweep
+    int done; // set when every job has finished
+    job *jobs;
+    long jobs_number;
+} monitor;
+
+
+int ParseList_Int( const char *value, int list[], int *number );
+int ParseList_Double( const char *value, double list[], int *number );
+int SetArgument( grid *g, const char *key, const char *value );
+int ReadConfig( grid *g, const char *name );
+int ParseGrid( int argc, char *argv[], grid *g );
+long JobId( int dim, int size, int beta, int order, int replica );
+long BuildJobs( const grid *g, job **jobs );
+void GroupEnsembles( job jobs[], long jobs_number, int every );
+long TakeJob( worker *w );
+void *RunJob( void *arg );
+void RunBatch( job jobs[], int lanes );
+void *Worker( void *arg );
+void WriteStatus( const char *name, job jobs[], long jobs_number, double start );
+void *Monitor( void *arg );
+void RunJobs( int workers, job jobs[], long jobs_number, const char *status, double status_every );
+void WriteResults( const char *name, job jobs[], long jobs_number );
+void WriteAutocorrelation( const char *name, job jobs[], long jobs_number );
+void CountsObject( FILE *fptr, const counts *c, int phase, double divisor );
+void WriteCounters( const char *name, job jobs[], long jobs_number );
+void FreeJobs( job jobs[], long jobs_number );
+
+
+int ParseList_Int( const char *value, int list[], int *number ){
+    // read a comma separated list of integers; return 1 if it is empty or too long
+    char copy[FILENAME_MAX];
+    snprintf( copy, sizeof(copy), "%s", value );
+    *number = 0;
+    for ( char *item=strtok( copy, "," ); item!=NULL; item=strtok( NULL, "," ) ){
+        if ( *number == MAX_LIST ){
+            return 1;
+        }
+        list[(*number)++] = atoi( item );
+    }
+    return *number == 0;
+}
+
+int ParseList_Double( const char *value, double list[], int *number ){
+    // read a comma separated list of numbers, each of which may be a range first:last:step
+    char copy[FILENAME_MAX];
+    snprintf( copy, sizeof(copy), "%s", value );
+    *number = 0;
+    for ( char *item=strtok( copy, "," ); item!=NULL; item=strtok( NULL, "," ) ){
+        double first, last, step;
+        if ( sscanf( item, "%lf:%lf:%lf", &first, &last, &step ) == 3 && step > 0 ){
+            int count = floor( (last-first)/step + 1e-9 ) + 1;
+            for ( int k=0; k<count; k++ ){
+                if ( *number == MAX_LIST ){
+                    return 1;
+                }
+                list[(*number)++] = first + k*step;
+            }
+        }
+        else{
+            if ( *number == MAX_LIST ){
+                return 1;
+            }
+            list[(*number)++] = atof( item );
+        }
+    }
+    return *number == 0;
+}
+
+int SetArgument( grid *g, const char *key, const char *value ){
+    // set one parameter of the grid from its name and value; return 1 on a bad argument
+    if ( strcmp( key, "dim" ) == 0 || strcmp( key, "dims" ) == 0 ){ return ParseList_Int( value, g->dims, &g->dims_number ); }
+    else if ( strcmp( key, "size" ) == 0 || strcmp( key, "sizes" ) == 0 ){ return ParseList_Int( value, g->sizes, &g->sizes_number ); }
+    else if ( strcmp( key, "beta" ) == 0 || strcmp( key, "betas" ) == 0 ){ return ParseList_Double( value, g->betas, &g->betas_number ); }
+    else if ( strcmp( key, "mcs" ) == 0 ){ g->base.mcs = atoi( value ); }
+    else if ( strcmp( key, "bins-size" ) == 0 ){ g->base.bins_size = atoi( value ); }
+    else if ( strcmp( key, "separation" ) == 0 ){ g->base.separation = atoi( value ); }
+    else if ( strcmp( key, "threads" ) == 0 ){ g->base.threads = atoi( value ); }
+    else if ( strcmp( key, "measure" ) == 0 ){
+        g->base.measure = ParseMeasure( value );
+        if ( g->base.measure < 0 ){
+            printf( "Unknown measurement %s\n", value );
+            return 1;
+        }
+    }
+    else if ( strcmp( key, "layout" ) == 0 ){
+        g->base.layout = ParseLayout( value );
+        if ( g->base.layout < 0 ){
+            printf( "Unknown layout %s\n", value );
+            return 1;
+        }
+    }
+    else if ( strcmp( key, "pages" ) == 0 ){
+        g->base.pages = ParsePages( value );
+        if ( g->base.pages < 0 ){
+            printf( "Unknown pages %s\n", value );
+            return 1;
+        }
+    }
+    else if ( strcmp( key, "seed" ) == 0 ){ g->base.seed = strtoull( value, NULL, 10 ); }
+    else if ( strcmp( key, "repeats" ) == 0 ){ g->repeats = atoi( value ); }
+    else if ( strcmp( key, "workers" ) == 0 ){ g->workers = atoi( value ); }
+    else if ( strcmp( key, "output" ) == 0 ){ snprintf( g->output, sizeof(g->output), "%s", value ); }
+    else if ( strcmp( key, "spill" ) == 0 ){ snprintf( g->spill, sizeof(g->spill), "%s", value ); }
+    else if ( strcmp( key, "checkpoint" ) == 0 ){ snprintf( g->checkpoint, sizeof(g->checkpoint), "%s", value ); }
+    else if ( strcmp( key, "checkpoint-every" ) == 0 ){ g->base.checkpoint_every = atof( value ); }
+    else if ( strcmp( key, "tempering" ) == 0 ){ g->base.tempering = atoi( value ); }
+    else if ( strcmp( key, "batch" ) == 0 ){ g->base.batch = atoi( value ) != 0; }
+    else if ( strcmp( key, "field" ) == 0 ){ g->base.field = atoi( value ) != 0; }
+    else if ( strcmp( key, "block" ) == 0 ){ g->base.block = atoi( value ); }
+    else if ( strcmp( key, "resume" ) == 0 ){
+        snprintf( g->checkpoint, sizeof(g->checkpoint), "%s", value );
+        g->base.resume = 1;
+    }
+    else if ( strcmp( key, "binary" ) == 0 ){ snprintf( g->binary, sizeof(g->binary), "%s", value ); }
+    else if ( strcmp( key, "autocorrelation" ) == 0 ){ snprintf( g->autocorrelation, sizeof(g->autocorrelation), "%s", value ); }
+    else if ( strcmp( key, "counters" ) == 0 ){ g->base.counters = atoi( value ) != 0; }
+    else if ( strcmp( key, "status" ) == 0 ){ snprintf( g->status, sizeof(g->status), "%s", value ); }
+    else if ( strcmp( key, "status-every" ) == 0 ){ g->status_every = atof( value ); }
+    else if ( strcmp( key, "config" ) == 0 ){ return ReadConfig( g, value ); }
+    else if ( strcmp( key, "orders" ) == 0 ){
+        char list[FILENAME_MAX];
+        snprintf( list, sizeof(list), "%s", value );
+        g->orders_number = 0;
+        for ( char *name=strtok( list, "," ); name!=NULL; name=strtok( NULL, "," ) ){
+            int order = ParseOrder( name );
+            if ( order < 0 ){
+                printf( "Unknown update order %s\n", name );
+                return 1;
+            }
+            if ( g->orders_number < ORDERS ){
+                g->orders[g->orders_number++] = order;
+            }
+        }
+    }
+    else{
+        printf( "Unknown argument %s\n", key );
+        return 1;
+    }
+    return 0;
+}
+
+int ReadConfig( grid *g, const char *name ){
+    // read "key = value" lines of a config file, # starts a comment
+    FILE *fptr = fopen( name, "r" );
+    if ( fptr == NULL ){
+        printf( "Cannot open config file %s\n", name );
+        return 1;
+    }
+
+    char line[FILENAME_MAX];
+    while ( fgets( line, sizeof(line), fptr ) != NULL ){
+        line[strcspn( line, "#\r\n" )] = 0;
+        char key[FILENAME_MAX], value[FILENAME_MAX];
+        if ( sscanf( line, " %[^= \t] = %s", key, value ) != 2 ){
+            continue;
+        }
+        if ( SetArgument( g, key, value ) ){
+            fclose( fptr );
+            return 1;
+        }
+    }
+    fclose( fptr );
+    return 0;
+}
+
+int ParseGrid( int argc, char *argv[], grid *g ){
+    // read the grid from "--key value" pairs on the command line; return 1 on a bad argument
+    g->base.dim = 0;
+    g->base.size = 0;
+    g->base.n = 0;
+    g->base.mcs = 10000;
+    g->base.bins_size = 100;
+    g->base.separation = 11;
+    g->base.threads = 4;
+    g->base.order = 0;
+    g->base.measure = MEASURE_DIRECT;
+    g->base.layout = LAYOUT_ROW;
+    g->base.pages = PAGES_TRANSPARENT;
+    g->base.binary = -1;
+    g->base.bins_offset = 0;
+    g->base.checkpoint_every = 600;
+    g->base.resume = 0;
+    g->base.tempering = 0;
+    g->base.replicas = NULL;
+    g->base.slot = 0;
+    g->base.batch = 0;
+    g->base.lanes = 1;
+    g->base.field = 0;
+    g->base.block = 1;
+    g->base.counters = 0;
+    g->base.telemetry = 0;
+    g->base.replica = 0;
+    g->base.job = 0;
+    g->base.seed = time(NULL);
+    g->base.beta = 0;
+    g->dims[0] = 2;
+    g->dims_number = 1;
+    g->sizes[0] = 64;
+    g->sizes_number = 1;
+    g->betas[0] = 0.6;
+    g->betas_number = 1;
+    g->orders_number = 0;
+    g->repeats = 10;
+    g->workers = sysconf( _SC_NPROCESSORS_ONLN );
+    snprintf( g->output, sizeof(g->output), "Results_ND.csv" );
+    g->spill[0] = 0;
+    g->autocorrelation[0] = 0;
+    g->binary[0] = 0;
+    g->checkpoint[0] = 0;
+    g->counters[0] = 0;
+    g->status[0] = 0;
+    g->status_every = 5;
+
+    for ( int i=1; i<argc; i+=2 ){
+        if ( strncmp( argv[i], "--", 2 ) != 0 || i+1 == argc ){
+            printf( "Expected --key value, got %s\n", argv[i] );
+            return 1;
+        }
+        if ( SetArgument( g, argv[i]+2, argv[i+1] ) ){
+            return 1;
+        }
+    }
+
+    if ( g->base.mcs < 1 || g->base.bins_size < 1 || g->base.separation < 1 || g->base.threads < 1 || g->repeats < 1 || g->workers < 1 ||
+         g->status_every <= 0 || g->base.tempering < 0 || g->base.block < 1 ){
+        printf( "Usage: IMND [--dims 1,2,3] [--sizes L,...] [--betas b,... or first:last:step] [--orders a,b,...] [--repeats r]\n"
+                "            [--mcs m] [--bins-size b] [--separation s] [--threads t] [--measure direct|fft|incremental]\n"
+                "            [--layout row|morton|hilbert|halo] [--pages normal|transparent|explicit]\n"
+                "            [--workers w] [--seed s] [--output file] [--binary file] [--spill prefix] [--autocorrelation file]\n"
+                "            [--checkpoint prefix] [--checkpoint-every seconds] [--resume prefix] [--counters 0|1]\n"
+                "            [--status file] [--status-every seconds] [--tempering sweeps] [--batch 0|1] [--field 0|1]\n"
+                "            [--block sweeps] [--config file]\n" );
+        return 1;
+    }
+    if ( g->repeats > MAX_REPEATS ){
+        printf( "At most %ld repetitions have job numbers of their own\n", MAX_REPEATS );
+        return 1;
+    }
+    if ( g->base.resume && g->binary[0] != 0 ){
+        printf( "The binary output cannot be resumed, the bins before the checkpoints are not in it\n" );
+        return 1;
+    }
+    if ( g->base.layout != LAYOUT_ROW && g->base.measure == MEASURE_INCREMENTAL ){
+        printf( "The incremental measurement needs the row layout\n" );
+        return 1;
+    }
+    if ( g->base.field && (g->base.layout != LAYOUT_ROW || g->base.batch) ){
+        printf( "The local field needs the row layout, without batches\n" );
+        return 1;
+    }
+    if ( g->base.block > 1 && (g->base.measure != MEASURE_DIRECT || g->autocorrelation[0] != 0) ){
+        printf( "Temporal blocking needs the direct measurement, without autocorrelation\n" );
+        return 1;
+    }
+    if ( g->base.tempering > 0 && (g->base.layout != LAYOUT_ROW || g->betas_number < 2) ){
+        printf( "Replica exchange needs the row layout and at least two temperatures\n" );
+        return 1;
+    }
+    if ( g->base.batch && (g->base.layout != LAYOUT_ROW || g->base.measure != MEASURE_DIRECT || g->checkpoint[0] != 0 ||
+                           g->autocorrelation[0] != 0 || g->base.tempering > 0) ){
+        printf( "A batch needs the row layout and the direct measurement, without checkpoints, autocorrelation or replica exchange\n" );
+        return 1;
+    }
+    for ( int i=0; i<g->dims_number; i++ ){
+        for ( int j=0; j<g->sizes_number; j++ ){
+            if ( g->dims[i] < 1 || g->dims[i] > MAX_DIM || g->sizes[j] < 2 || Power( g->sizes[j], g->dims[i] ) > UINT32_MAX ||
+                 (g->base.layout == LAYOUT_HALO && HaloSites( g->dims[i], g->sizes[j], g->base.separation ) > UINT32_MAX) ){
+                printf( "Cannot run a %dD lattice of size %d\n", g->dims[i], g->sizes[j] );
+                return 1;
+            }
+        }
+    }
+    g->base.spill = g->spill[0] != 0 ? g->spill : NULL;
+    g->base.series = g->autocorrelation[0] != 0;
+    g->base.checkpoint = g->checkpoint[0] != 0 ? g->checkpoint : NULL;
+    g->base.telemetry = g->status[0] != 0;
+    if ( g->base.counters ){
+        // Results_ND.csv -> Results_ND_counters.json
+        int stem = strlen( g->output );
+        if ( stem >= 4 && strcmp( g->output+stem-4, ".csv" ) == 0 ){
+            stem -= 4;
+        }
+        snprintf( g->counters, sizeof(g->counters), "%.*s_counters.json", stem, g->output );
+    }
+    return 0;
+}
+
+long JobId( int dim, int size, int beta, int order, int replica ){
+    // return the number of a run from its place in the grid: its dimension, the indices of its size and beta in their
+    // lists, its update order and repetition; it does not depend on the orders chosen or skipped, nor on the layout,
+    // so a run keeps its random number streams and checkpoint whatever else is in the sweep
+    return (long)replica*JOB_CELLS + (((long)(dim-1)*MAX_LIST + size)*MAX_LIST + beta)*ORDERS + order;
+}
+
+long BuildJobs( const grid *g, job **jobs ){
+    // list every job of the grid, skipping update orders a lattice does not support, and group them into ensembles
+    // with replica exchange; return the number of jobs
+    long capacity = (long)g->dims_number*g->sizes_number*g->betas_number*ORDERS*g->repeats;
+    *jobs = malloc( capacity*sizeof(job) );
+    long count = 0;
+
+    for ( int i=0; i<g->dims_number; i++ ){
+        for ( int j=0; j<g->sizes_number; j++ ){
+            for ( int k=0; k<g->betas_number; k++ ){
+                for ( int order=0; order<ORDERS; order++ ){
+                    int chosen = g->orders_number == 0 && !AlgorithmOrder( order );
+                    for ( int o=0; o<g->orders_number; o++ ){
+                        chosen |= g->orders[o] == order;
+                    }
+                    if ( !chosen ){
+                        continue;
+                    }
+                    if ( !OrderSupported( order, g->dims[i], g->sizes[j] ) ){
+                        if ( g->orders_number > 0 && k == 0 ){
+                            printf( "Skipping %s, it does not support a %dD lattice of size %d\n", ORDER_NAMES[order], g->dims[i], g->sizes[j] );
+                        }
+                        continue;
+                    }
+                    if ( !LayoutSupported( g->base.layout, order, g->dims[i], g->sizes[j] ) ){
+                        if ( k == 0 ){
+                            printf( "Skipping %s, the %s layout does not support it on a %dD lattice of size %d\n", ORDER_NAMES[order],
+                                    LAYOUT_NAMES[g->base.layout], g->dims[i], g->sizes[j] );
+                        }
+                        continue;
+                    }
+                    if ( g->base.tempering > 0 && (order == ORDER_CHECKERBOARD || order == ORDER_SWENDSEN_WANG) ){
+                        if ( k == 0 ){
+                            printf( "Skipping %s, its threads cannot exchange replicas\n", ORDER_NAMES[order] );
+                        }
+                        continue;
+                    }
+                    if ( g->base.batch && (order == ORDER_RANDOM || order == ORDER_CHECKERBOARD || AlgorithmOrder( order )) ){
+                        if ( k == 0 ){
+                            printf( "Skipping %s, its repetitions do not visit the same sites in a batch\n", ORDER_NAMES[order] );
+                        }
+                        continue;
+                    }
+                    for ( int r=0; r<g->repeats; r++ ){
+                        job *jb = &(*jobs)[count];
+                        jb->p = g->base;
+                        jb->p.dim = g->dims[i];
+                        jb->p.size = g->sizes[j];
+                        jb->p.n = Power( g->sizes[j], g->dims[i] );
+                        jb->p.beta = g->betas[k];
+                        jb->p.order = order;
+                        jb->p.replica = r;
+                        jb->p.job = JobId( g->dims[i], j, k, order, r );
+                        if ( jb->p.batch ){
+                            jb->p.lanes = r%BATCH_LANES > 0 ? 0 : g->repeats-r < BATCH_LANES ? g->repeats-r : BATCH_LANES;
+                        }
+                        if ( jb->p.measure == MEASURE_FFT ){
+                            jb->p.separation = g->sizes[j]/2+1; // the fft gives every separation
+                        }
+                        jb->bins_number = ceil( (double)jb->p.mcs/(double)jb->p.bins_size );
+                        jb->avg = malloc( jb->p.separation*sizeof(double) );
+                        jb->standard_deviation = malloc( jb->p.separation*sizeof(double) );
+                        memset( &jb->status, 0, sizeof(jb->status) );
+                        count++;
+                    }
+                }
+            }
+        }
+    }
+    if ( g->base.tempering > 0 ){
+        GroupEnsembles( *jobs, count, g->base.tempering );
+    }
+    return count;
+}
+
+void GroupEnsembles( job jobs[], long jobs_number, int every ){
+    // make one ensemble of the jobs of each dimension, size, update order and repetition, its slots sorted by beta
+    for ( long j=0; j<jobs_number; j++ ){
+        if ( jobs[j].p.replicas != NULL ){
+            continue;
+        }
+        const parameters *first = &jobs[j].p;
+        long members[MAX_LIST];
+        int replicas = 0;
+        for ( long i=j; i<jobs_number; i++ ){
+            const parameters *q = &jobs[i].p;
+            if ( q->replicas == NULL && q->dim == first->dim && q->size == first->size && q->order == first->order &&
+                 q->replica == first->replica ){
+                // insert by beta
+                int slot = replicas++;
+                while ( slot > 0 && jobs[members[slot-1]].p.beta > q->beta ){
+                    members[slot] = members[slot-1];
+                    slot--;
+                }
+                members[slot] = i;
+            }
+        }
+        ensemble *e = malloc( sizeof(ensemble) );
+        EnsembleInit( e, replicas, every, first->seed );
+        for ( int slot=0; slot<replicas; slot++ ){
+            e->jobs[slot] = members[slot];
+            e->ids[slot] = jobs[members[slot]].p.job;
+            e->beta[slot] = jobs[members[slot]].p.beta;
+            jobs[members[slot]].p.replicas = e;
+            jobs[members[slot]].p.slot = slot;
+        }
+    }
+}
+
+long TakeJob( worker *w ){
+    // return a job from the bottom of the worker's own deque or, when it is empty, from the top of another; -1 if none is left
+    deque *own = &w->deques[w->id];
+    long j = -1;
+    pthread_mutex_lock( &own->lock );
+    if ( own->bottom > own->top ){
+        j = own->jobs[--own->bottom];
+    }
+    pthread_mutex_unlock( &own->lock );
+
+    for ( int k=1; k<w->workers && j<0; k++ ){
+        deque *victim = &w->deques[(w->id+k)%w->workers];
+        pthread_mutex_lock( &victim->lock );
+        if ( victim->bottom > victim->top ){
+            j = victim->jobs[victim->top++];
+        }
+        pthread_mutex_unlock( &victim->lock );
+    }
+    return j;
+}
+
+void *RunJob( void *arg ){
+    // run one job
+    job *jb = (job *)arg;
+    TelemetryStart( &jb->status );
+    Run( &jb->p, jb->bins_number, jb->avg, jb->standard_deviation, &jb->result, &jb->events, &jb->status );
+    TelemetryDone( &jb->status );
+    return NULL;
+}
+
+void RunBatch( job jobs[], int lanes ){
+    // run a batch of jobs, the repetitions after the first
+    lane batch[lanes];
+    for ( int l=0; l<lanes; l++ ){
+        batch[l] = (lane){ &jobs[l].p, jobs[l].avg, jobs[l].standard_deviation, &jobs[l].result, &jobs[l].events, &jobs[l].status };
+        TelemetryStart( &jobs[l].status );
+    }
+    Run_Batch( batch, lanes, jobs[0].bins_number );
+    for ( int l=0; l<lanes; l++ ){
+        TelemetryDone( &jobs[l].status );
+    }
+}
+
+void *Worker( void *arg ){
+    // run jobs until no deque has any left; the job of slot 0 of an ensemble stands for the whole ensemble, whose
+    // other replicas run on threads of their own, and the first job of a batch for the batch
+    worker *w = (worker *)arg;
+    for ( long j=TakeJob( w ); j>=0; j=TakeJob( w ) ){
+        ensemble *e = w->jobs[j].p.replicas;
+        int replicas = e != NULL ? e->replicas : w->jobs[j].p.lanes;
+        long members[replicas];
+        pthread_t handles[replicas];
+        for ( int slot=0; slot<replicas; slot++ ){
+            members[slot] = e != NULL ? e->jobs[slot] : j+slot;
+        }
+        if ( w->jobs[j].p.batch ){
+            RunBatch( &w->jobs[j], replicas );
+        }
+        else{
+            for ( int slot=1; slot<replicas; slot++ ){
+                pthread_create( &handles[slot], NULL, RunJob, &w->jobs[members[slot]] );
+            }
+            RunJob( &w->jobs[j] );
+            for ( int slot=1; slot<replicas; slot++ ){
+                pthread_join( handles[slot], NULL );
+            }
+        }
+
+        pthread_mutex_lock( w->progress );
+        for ( int slot=0; slot<replicas; slot++ ){
+            job *jb = &w->jobs[members[slot]];
+            (*w->completed)++;
+            printf( "%s Completed - %dD, size %d, beta %.2f, repetition %d - %ld/%ld...\n", ORDER_NAMES[jb->p.order], jb->p.dim,
+                    jb->p.size, jb->p.beta, jb->p.replica+1, *w->completed, w->jobs_number );
+        }
+        for ( int slot=0; slot+1<replicas && e!=NULL; slot++ ){
+            printf( "    exchanges beta %.2f <-> %.2f accepted %ld/%ld\n", e->beta[slot], e->beta[slot+1], e->accepted[slot],
+                    e->attempted[slot] );
+        }
+        pthread_mutex_unlock( w->progress );
+    }
+    return NULL;
+}
+
+void WriteStatus( const char *name, job jobs[], long jobs_number, double start ){
+    // write the progress of the sweep as json lines to name.tmp and rename it over the last status: one line for the
+    // sweep, one per update order over all its started jobs, and one per running job; idle_seconds is the time since
+    // the last sweep of a job, updates_per_second counts site updates (attempted flips)
+    char temporary[FILENAME_MAX+4];
+    snprintf( temporary, sizeof(temporary), "%s.tmp", name );
+    FILE *fptr = fopen( temporary, "w" );
+    if ( fptr == NULL ){
+        printf( "Cannot open %s\n", temporary );
+        return;
+    }
+    double now = WallSeconds();
+    long states[RUN_STATES] = { 0 };
+    double updates[ORDERS] = { 0 }, accepted[ORDERS] = { 0 }, seconds[ORDERS] = { 0 }, rate = 0;
+    for ( long j=0; j<jobs_number; j++ ){
+        telemetry t;
+        TelemetryLoad( &jobs[j].status, &t );
+        states[t.state]++;
+        if ( t.state != RUN_WAITING ){
+            int order = jobs[j].p.order;
+            updates[order] += (double)t.sweeps*jobs[j].p.n;
+            accepted[order] += t.accepted;
+            seconds[order] += t.updated-t.start;
+        }
+        if ( t.state == RUN_RUNNING && now > t.start ){
+            rate += (double)t.sweeps*jobs[j].p.n/(now-t.start);
+        }
+    }
+    fprintf( fptr, "{\"type\": \"sweep\", \"time\": %ld, \"elapsed_seconds\": %.3f, \"jobs\": %ld, \"waiting\": %ld, \"running\": %ld, "
+                   "\"done\": %ld, \"updates_per_second\": %.6g}\n", (long)time(NULL), now-start, jobs_number, states[RUN_WAITING],
+             states[RUN_RUNNING], states[RUN_DONE], rate );
+    for ( int order=0; order<ORDERS; order++ ){
+        if ( updates[order] > 0 ){
+            fprintf( fptr, "{\"type\": \"order\", \"order\": \"%s\", \"updates\": %.17g, \"accepted\": %.17g, \"acceptance\": %.6f, "
+                           "\"updates_per_second\": %.6g}\n", ORDER_NAMES[order], updates[order], accepted[order],
+                     accepted[order]/updates[order], seconds[order] > 0 ? updates[order]/seconds[order] : 0 );
+        }
+    }
+    for ( long j=0; j<jobs_number; j++ ){
+        telemetry t;
+        TelemetryLoad( &jobs[j].status, &t );
+        if ( t.state != RUN_RUNNING ){
+            continue;
+        }
+        const parameters *p = &jobs[j].p;
+        double sites = (double)t.sweeps*p->n;
+        fprintf( fptr, "{\"type\": \"job\", \"job\": %ld, \"dim\": %d, \"size\": %d, \"beta\": %.4f, \"order\": \"%s\", \"repetition\": %d, "
+                       "\"bin\": %d, \"bins_number\": %d, \"sweeps\": %ld, \"acceptance\": %.6f, \"updates_per_second\": %.6g, "
+                       "\"elapsed_seconds\": %.3f, \"idle_seconds\": %.3f", j, p->dim, p->size, p->beta, ORDER_NAMES[p->order],
+                 p->replica, t.bin, jobs[j].bins_number, t.sweeps, sites > 0 ? t.accepted/sites : 0,
+                 now > t.start ? sites/(now-t.start) : 0, now-t.start, now-t.updated );
+        for ( int phase=0; phase<PHASES; phase++ ){
+            fprintf( fptr, ", \"%s_seconds\": %.3f", PHASE_NAMES[phase], t.seconds[phase] );
+        }
+        fprintf( fptr, "}\n" );
+    }
+    if ( fclose( fptr ) != 0 || rename( temporary, name ) != 0 ){
+        printf( "Cannot write %s\n", name );
+    }
+}
+
+void *Monitor( void *arg ){
+    // rewrite the status file every few seconds until all jobs are done, and once more at the end
+    monitor *m = (monitor *)arg;
+    while ( !__atomic_load_n( &m->done, __ATOMIC_ACQUIRE ) ){
+        WriteStatus( m->name, m->jobs, m->jobs_number, m->start );
+        double next = WallSeconds()+m->every;
+        while ( WallSeconds() < next && !__atomic_load_n( &m->done, __ATOMIC_ACQUIRE ) ){
+            usleep( 50000 );
+        }
+    }
+    WriteStatus( m->name, m->jobs, m->jobs_number, m->start );
+    return NULL;
+}
+
+void RunJobs( int workers, job jobs[], long jobs_number, const char *status, double status_every ){
+    // run all jobs on a pool of workers, the status file (if any) written by a thread of its own;
+    // jobs are dealt out by size, the biggest at the bottom of each deque, ensembles by the job of their slot 0 and
+    // batches by their first job
+    long *sorted = malloc( jobs_number*sizeof(long) );
+    for ( long j=0; j<jobs_number; j++ ){
+        sorted[j] = j;
+    }
+    for ( long j=1; j<jobs_number; j++ ){
+        long key = sorted[j];
+        double cost = (double)jobs[key].p.n*jobs[key].p.mcs;
+        long k = j-1;
+        while ( k >= 0 && (double)jobs[sorted[k]].p.n*jobs[sorted[k]].p.mcs > cost ){
+            sorted[k+1] = sorted[k];
+            k--;
+        }
+        sorted[k+1] = key;
+    }
+
+    deque deques[workers];
+    for ( int w=0; w<workers; w++ ){
+        pthread_mutex_init( &deques[w].lock, NULL );
+        deques[w].jobs = malloc( (jobs_number/workers+1)*sizeof(long) );
+        deques[w].top = 0;
+        deques[w].bottom = 0;
+    }
+    long dealt = 0;
+    for ( long j=0; j<jobs_number; j++ ){
+        if ( jobs[sorted[j]].p.slot == 0 && jobs[sorted[j]].p.lanes > 0 ){
+            deque *d = &deques[dealt++%workers];
+            d->jobs[d->bottom++] = sorted[j];
+        }
+    }
+
+    long completed = 0;
+    pthread_mutex_t progress;
+    pthread_mutex_init( &progress, NULL );
+    worker pool[workers];
+    pthread_t handles[workers];
+    for ( int w=0; w<workers; w++ ){
+        pool[w].id = w;
+        pool[w].workers = workers;
+        pool[w].deques = deques;
+        pool[w].jobs = jobs;
+        pool[w].jobs_number = jobs_number;
+        pool[w].completed = &completed;
+        pool[w].progress = &progress;
+    }
+    monitor watch = { status, status_every, WallSeconds(), 0, jobs, jobs_number };
+    pthread_t watcher;
+    if ( status != NULL ){
+        pthread_create( &watcher, NULL, Monitor, &watch );
+    }
+    for ( int w=1; w<workers; w++ ){
+        pthread_create( &handles[w], NULL, Worker, &pool[w] );
+    }
+    Worker( &pool[0] );
+    for ( int w=1; w<workers; w++ ){
+        pthread_join( handles[w], NULL );
+    }
+    if ( status != NULL ){
+        __atomic_store_n( &watch.done, 1, __ATOMIC_RELEASE );
+        pthread_join( watcher, NULL );
+    }
+
+    pthread_mutex_destroy( &progress );
+    for ( int w=0; w<workers; w++ ){
+        pthread_mutex_destroy( &deques[w].lock );
+        free( deques[w].jobs );
+    }
+    free( sorted );
+}
+
+void WriteResults( const char *name, job jobs[], long jobs_number ){
+    // write the results of all jobs into one csv file, one row per job and separation
+    FILE *fptr = fopen( name, "w" );
+    if ( fptr == NULL ){
+        printf( "Cannot open %s\n", name );
+        return;
+    }
+    fprintf( fptr, "dim,size,beta,mcs,bins_size,order,measure,layout,repetition,seed,separation,avg,sd\n" );
+    for ( long j=0; j<jobs_number; j++ ){
+        parameters *p = &jobs[j].p;
+        for ( int d=0; d<p->separation; d++ ){
+            fprintf( fptr, "%d,%d,%.4f,%d,%d,%s,%s,%s,%d,%llu,%d,%lf,%lf\n", p->dim, p->size, p->beta, p->mcs, p->bins_size, ORDER_NAMES[p->order],
+                     MEASURE_NAMES[p->measure], LAYOUT_NAMES[p->layout], p->replica, (unsigned long long)p->seed, d, jobs[j].avg[d], jobs[j].standard_deviation[d] );
+        }
+    }
+    fclose( fptr );
+}
+
+void WriteAutocorrelation( const char *name, job jobs[], long jobs_number ){
+    // write the autocorrelation of every observable of all jobs into one csv file, one row per job and observable;
+    // samples_per_second = effectively independent samples per cpu-second of the run
+    FILE *fptr = fopen( name, "w" );
+    if ( fptr == NULL ){
+        printf( "Cannot open %s\n", name );
+        return;
+    }
+    fprintf( fptr, "dim,size,beta,mcs,order,measure,layout,repetition,seed,observable,mean,tau,tau_error,window,tau_binning,"
+                   "effective_samples,cpu_seconds,samples_per_second\n" );
+    for ( long j=0; j<jobs_number; j++ ){
+        parameters *p = &jobs[j].p;
+        analysis *a = &jobs[j].result;
+        for ( int o=0; o<OBSERVABLES; o++ ){
+            autocorrelation *c = &a->observables[o];
+            fprintf( fptr, "%d,%d,%.4f,%d,%s,%s,%s,%d,%llu,%s,%lf,%lf,%lf,%ld,%lf,%lf,%lf,%lf\n", p->dim, p->size, p->beta, p->mcs,
+                     ORDER_NAMES[p->order], MEASURE_NAMES[p->measure], LAYOUT_NAMES[p->layout], p->replica, (unsigned long long)p->seed,
+                     OBSERVABLE_NAMES[o], c->mean, c->tau, c->tau_error, c->window, c->tau_binning, c->effective, a->cpu_seconds,
+                     c->effective/a->cpu_seconds );
+        }
+    }
+    fclose( fptr );
+}
+
+void CountsObject( FILE *fptr, const counts *c, int phase, double divisor ){
+    // write the counts of one phase, or of all phases if phase < 0, divided by divisor as a json object; counters
+    // that could not be opened are null, llc_bytes takes one cache line per last level cache miss
+    double seconds = 0, value[COUNTERS] = { 0 };
+    for ( int ph=0; ph<PHASES; ph++ ){
+        if ( phase < 0 || ph == phase ){
+            seconds += c->seconds[ph];
+            for ( int k=0; k<COUNTERS; k++ ){
+                value[k] += c->value[ph][k];
+            }
+        }
+    }
+    fprintf( fptr, "{\"seconds\": %.6g", seconds/divisor );
+    for ( int k=0; k<COUNTERS; k++ ){
+        if ( c->available & (1 << k) ){
+            fprintf( fptr, ", \"%s\": %.6g", COUNTER_NAMES[k], value[k]/divisor );
+        }
+        else{
+            fprintf( fptr, ", \"%s\": null", COUNTER_NAMES[k] );
+        }
+    }
+    if ( c->available & (1 << COUNTER_LLC_MISSES) ){
+        fprintf( fptr, ", \"llc_bytes\": %.6g}", value[COUNTER_LLC_MISSES]*ARENA_ALIGN/divisor );
+    }
+    else{
+        fprintf( fptr, ", \"llc_bytes\": null}" );
+    }
+}
+
+void WriteCounters( const char *name, job jobs[], long jobs_number ){
+    // write the hardware events of all jobs into a json file: the totals of every phase of each job, and per site
+    // update for each update order, summed over the jobs of the same lattice, measurement and layout
+    FILE *fptr = fopen( name, "w" );
+    if ( fptr == NULL ){
+        printf( "Cannot open %s\n", name );
+        return;
+    }
+    int available = 0;
+    for ( long j=0; j<jobs_number; j++ ){
+        available |= jobs[j].events.available;
+    }
+    if ( available == 0 ){
+        printf( "No hardware counters could be opened (perf_event_open), only the time of each phase is in %s\n", name );
+    }
+
+    fprintf( fptr, "{\"format\": \"imnd-counters\", \"version\": 1,\n \"orders\": [" );
+    for ( long j=0; j<jobs_number; j++ ){
+        const parameters *p = &jobs[j].p;
+        int first = 1;
+        for ( long i=0; i<j && first; i++ ){
+            const parameters *q = &jobs[i].p;
+            first = !(q->dim == p->dim && q->size == p->size && q->order == p->order && q->measure == p->measure && q->layout == p->layout);
+        }
+        if ( !first ){
+            continue;
+        }
+        counts sum;
+        CountsClear( &sum );
+        int runs = 0;
+        for ( long i=j; i<jobs_number; i++ ){
+            const parameters *q = &jobs[i].p;
+            if ( q->dim == p->dim && q->size == p->size && q->order == p->order && q->measure == p->measure && q->layout == p->layout ){
+                CountsAdd( &sum, &jobs[i].events );
+                sum.updates += jobs[i].events.updates;
+                runs++;
+            }
+        }
+        fprintf( fptr, "%s\n  {\"dim\": %d, \"size\": %d, \"order\": \"%s\", \"measure\": \"%s\", \"layout\": \"%s\", \"jobs\": %d, "
+                       "\"updates\": %.17g,\n   \"per_update\": {\"total\": ", j == 0 ? "" : ",", p->dim, p->size, ORDER_NAMES[p->order],
+                 MEASURE_NAMES[p->measure], LAYOUT_NAMES[p->layout], runs, sum.updates );
+        CountsObject( fptr, &sum, -1, sum.updates );
+        for ( int phase=0; phase<PHASES; phase++ ){
+            fprintf( fptr, ",\n    \"%s\": ", PHASE_NAMES[phase] );
+            CountsObject( fptr, &sum, phase, sum.updates );
+        }
+        fprintf( fptr, "}}" );
+    }
+
+    fprintf( fptr, "\n ],\n \"jobs\": [" );
+    for ( long j=0; j<jobs_number; j++ ){
+        const parameters *p = &jobs[j].p;
+        const counts *c = &jobs[j].events;
+        fprintf( fptr, "%s\n  {\"dim\": %d, \"size\": %d, \"beta\": %.4f, \"mcs\": %d, \"order\": \"%s\", \"measure\": \"%s\", "
+                       "\"layout\": \"%s\", \"repetition\": %d, \"seed\": %llu, \"updates\": %.17g,\n   \"phases\": {\"total\": ",
+                 j == 0 ? "" : ",", p->dim, p->size, p->beta, p->mcs, ORDER_NAMES[p->order], MEASURE_NAMES[p->measure],
+                 LAYOUT_NAMES[p->layout], p->replica, (unsigned long long)p->seed, c->updates );
+        CountsObject( fptr, c, -1, 1 );
+        for ( int phase=0; phase<PHASES; phase++ ){
+            fprintf( fptr, ",\n    \"%s\": ", PHASE_NAMES[phase] );
+            CountsObject( fptr, c, phase, 1 );
+        }
+        fprintf( fptr, "}}" );
+    }
+    fprintf( fptr, "\n ]}\n" );
+    fclose( fptr );
+}
+
+void FreeJobs( job jobs[], long jobs_number ){
+    // free the results of all jobs, their ensembles and the job list
+    for ( long j=0; j<jobs_number; j++ ){
+        free( jobs[j].avg );
+        free( jobs[j].standard_deviation );
+        if ( jobs[j].p.replicas != NULL && jobs[j].p.slot == 0 ){
+            EnsembleFree( jobs[j].p.replicas );
+            free( jobs[j].p.replicas );
+        }
+    }
+    free( jobs );
+}
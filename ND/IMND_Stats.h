@@ -0,0 +1,101 @@
+// this file needs to be in the same directory as the main file
+// streaming statistics of the correlation over bins: the mean and variance are updated as each bin closes
+// (Welford), so the memory does not grow with the length of the chain and the result can be read at any time;
+// the raw value of each bin can be spilled to a csv file and written to its place in the binary output of the sweep
+
+// running statistics of one run
+typedef struct{
+    int separation;
+    long bins; // number of closed bins
+    double *bin; // correlation summed over the current bin
+    double *mean; // mean over the closed bins
+    double *m2; // sum of squared deviations from the mean
+    FILE *spill; // raw value of each bin, one row per bin, or NULL
+    int binary; // descriptor of the binary output of the sweep, or -1
+    long offset; // byte offset of the bins of the run in the binary output
+} stats;
+
+
+int StatsInit( stats *s, int separation, arena *memory, const char *spill, long position, int binary, long offset );
+void StatsCloseBin( stats *s );
+void StatsResult( const stats *s, double avg[], double standard_deviation[] );
+void StatsFree( stats *s );
+
+
+int StatsInit( stats *s, int separation, arena *memory, const char *spill, long position, int binary, long offset ){
+    // take the accumulators from the arena and open the spill file if one is named, a new one or, for a resumed
+    // run, the old one cut back to position; return 1 if it cannot be opened
+    s->separation = separation;
+    s->binary = binary;
+    s->offset = offset;
+    s->bins = 0;
+    s->bin = ArenaAlloc( memory, separation*sizeof(double) );
+    s->mean = ArenaAlloc( memory, separation*sizeof(double) );
+    s->m2 = ArenaAlloc( memory, separation*sizeof(double) );
+    s->spill = NULL;
+
+    if ( spill != NULL ){
+        s->spill = fopen( spill, position < 0 ? "w" : "r+" );
+        if ( s->spill == NULL ){
+            printf( "Cannot open %s\n", spill );
+            return 1;
+        }
+        if ( position >= 0 ){
+            if ( ftruncate( fileno( s->spill ), position ) != 0 ){
+                printf( "Cannot cut %s back to the checkpoint\n", spill );
+                return 1;
+            }
+            fseek( s->spill, position, SEEK_SET );
+            return 0;
+        }
+        fprintf( s->spill, "bin" );
+        for ( int d=0; d<separation; d++ ){
+            fprintf( s->spill, ",%d", d );
+        }
+        fprintf( s->spill, "\n" );
+    }
+    return 0;
+}
+
+void StatsCloseBin( stats *s ){
+    // add the current bin to the running mean and variance, spill it and start a new bin; the bins of every run
+    // have their own place in the binary output, so the runs write to it at the same time without a lock
+    if ( s->binary >= 0 ){
+        size_t bytes = s->separation*sizeof(double);
+        if ( pwrite( s->binary, s->bin, bytes, s->offset + s->bins*bytes ) != (ssize_t)bytes ){
+            printf( "Cannot write bin %ld to the binary output\n", s->bins );
+        }
+    }
+    s->bins++;
+    if ( s->spill != NULL ){
+        fprintf( s->spill, "%ld", s->bins-1 );
+    }
+    for ( int d=0; d<s->separation; d++ ){
+        double delta = s->bin[d] - s->mean[d];
+        s->mean[d] += delta/s->bins;
+        s->m2[d] += delta*(s->bin[d] - s->mean[d]);
+        if ( s->spill != NULL ){
+            fprintf( s->spill, ",%.17g", s->bin[d] );
+        }
+        s->bin[d] = 0;
+    }
+    if ( s->spill != NULL ){
+        fprintf( s->spill, "\n" );
+    }
+}
+
+void StatsResult( const stats *s, double avg[], double standard_deviation[] ){
+    // average correlation over the closed bins and its standard deviation for each separation value
+    for ( int d=0; d<s->separation; d++ ){
+        avg[d] = s->mean[d];
+        standard_deviation[d] = sqrt( s->m2[d]/(s->bins-1) );
+    }
+}
+
+void StatsFree( stats *s ){
+    // close the spill file; the accumulators go with the arena
+    if ( s->spill != NULL ){
+        fclose( s->spill );
+        s->spill = NULL;
+    }
+}
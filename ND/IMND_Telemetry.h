@@ -0,0 +1,81 @@
+// this file needs to be in the same directory as the main file
+// live telemetry of a sweep: every run publishes its bin, sweeps, accepted flips and the time of each phase once a
+// sweep with relaxed atomic stores, the threads of a run adding their accepted flips as they finish the sweep; a
+// monitor thread reads them and rewrites the status file every few seconds, so slow or stuck runs show up while the
+// sweep is still going
+
+// states of a run
+enum{ RUN_WAITING, RUN_RUNNING, RUN_DONE, RUN_STATES };
+const char *RUN_STATE_NAMES[RUN_STATES] = { "waiting", "running", "done" };
+
+// progress of one run, written by its threads and read by the monitor
+typedef struct{
+    int state;
+    int bin; // closed bins, including those before a checkpoint
+    long sweeps; // sweeps run since the start of the run
+    long accepted; // accepted flips of those sweeps
+    double start; // wall time of the start of the run
+    double updated; // wall time of the last sweep
+    double seconds[PHASES]; // time of the calling thread in each phase
+} telemetry;
+
+
+void TelemetryStart( telemetry *t );
+void TelemetrySweep( telemetry *t, long sweeps, long accepted, const counters *c );
+void TelemetryBin( telemetry *t, int bin );
+void TelemetryDone( telemetry *t );
+void TelemetryLoad( telemetry *t, telemetry *copy );
+
+
+void TelemetryStart( telemetry *t ){
+    // mark the run as running from now
+    double now = WallSeconds();
+    __atomic_store( &t->start, &now, __ATOMIC_RELAXED );
+    __atomic_store( &t->updated, &now, __ATOMIC_RELAXED );
+    __atomic_store_n( &t->state, RUN_RUNNING, __ATOMIC_RELEASE );
+}
+
+void TelemetrySweep( telemetry *t, long sweeps, long accepted, const counters *c ){
+    // add the accepted flips of one thread at the end of a sweep; the thread that counts the sweep (sweeps = 1)
+    // also publishes the time and its phase times from c; nothing if the run is not watched (t is NULL)
+    if ( t == NULL ){
+        return;
+    }
+    __atomic_fetch_add( &t->accepted, accepted, __ATOMIC_RELAXED );
+    if ( sweeps == 0 ){
+        return;
+    }
+    double now = WallSeconds();
+    __atomic_fetch_add( &t->sweeps, sweeps, __ATOMIC_RELAXED );
+    __atomic_store( &t->updated, &now, __ATOMIC_RELAXED );
+    for ( int phase=0; phase<PHASES; phase++ ){
+        __atomic_store( &t->seconds[phase], &c->total.seconds[phase], __ATOMIC_RELAXED );
+    }
+}
+
+void TelemetryBin( telemetry *t, int bin ){
+    // publish the number of closed bins
+    if ( t != NULL ){
+        __atomic_store_n( &t->bin, bin, __ATOMIC_RELAXED );
+    }
+}
+
+void TelemetryDone( telemetry *t ){
+    // mark the run as done
+    double now = WallSeconds();
+    __atomic_store( &t->updated, &now, __ATOMIC_RELAXED );
+    __atomic_store_n( &t->state, RUN_DONE, __ATOMIC_RELEASE );
+}
+
+void TelemetryLoad( telemetry *t, telemetry *copy ){
+    // read the progress of a run; the fields are each up to date, not necessarily of the same sweep
+    copy->state = __atomic_load_n( &t->state, __ATOMIC_ACQUIRE );
+    copy->bin = __atomic_load_n( &t->bin, __ATOMIC_RELAXED );
+    copy->sweeps = __atomic_load_n( &t->sweeps, __ATOMIC_RELAXED );
+    copy->accepted = __atomic_load_n( &t->accepted, __ATOMIC_RELAXED );
+    __atomic_load( &t->start, &copy->start, __ATOMIC_RELAXED );
+    __atomic_load( &t->updated, &copy->updated, __ATOMIC_RELAXED );
+    for ( int phase=0; phase<PHASES; phase++ ){
+        __atomic_load( &t->seconds[phase], &copy->seconds[phase], __ATOMIC_RELAXED );
+    }
+}
@@ -0,0 +1,139 @@
+// this file needs to be in the same directory as the main file
+// replica exchange (parallel tempering): the runs of one lattice, update order and repetition at all temperatures
+// of the sweep run at the same time, one thread each, and every few sweeps neighbouring temperatures offer to swap
+// their configurations, accepted with probability min(1, exp((b_k-b_k+1)(E_k-E_k+1))); the swaps are drawn from a
+// stream of the exchange number, so the chains do not depend on the timing of the threads and resume exactly
+
+// runs exchanging their configurations; slot k holds the k-th lowest beta
+typedef struct{
+    int replicas;
+    int every; // sweeps between exchanges
+    uint64_t seed;
+    long *jobs; // index of the job of each slot in the list of the scheduler
+    long *ids; // job number of each slot, the swaps are drawn from the streams 1, 2, ... of the job of slot 0
+    double *beta;
+    double *energy; // energy of the configuration of each slot at the current exchange
+    void **lattice; // configuration of each slot
+    long **sums; // incremental correlation sums of each slot, or NULL
+    int length; // longs in each sums
+    long bytes; // bytes of a configuration
+    long *bins; // closed bins of each slot at the start, -1 if the slot could not start
+    int *swap; // 1 if slot k swaps with slot k+1 at the current exchange
+    long *attempted; // swaps offered between slot k and k+1
+    long *accepted;
+    int write; // 1 if every slot writes a checkpoint at the end of the current bin
+    pthread_barrier_t barrier;
+} ensemble;
+
+
+void EnsembleInit( ensemble *e, int replicas, int every, uint64_t seed );
+int EnsembleJoin( ensemble *e, int slot, void *lattice, long bytes, long sums[], int length, long bins );
+int EnsembleExchange( ensemble *e, int slot, double energy, long number );
+int EnsembleCheckpoint( ensemble *e, int slot, int due );
+void EnsembleFree( ensemble *e );
+
+
+void EnsembleInit( ensemble *e, int replicas, int every, uint64_t seed ){
+    // allocate an ensemble of replicas; the scheduler fills in the jobs, job numbers and betas of the slots
+    e->replicas = replicas;
+    e->every = every;
+    e->seed = seed;
+    e->jobs = malloc( replicas*sizeof(long) );
+    e->ids = malloc( replicas*sizeof(long) );
+    e->beta = malloc( replicas*sizeof(double) );
+    e->energy = malloc( replicas*sizeof(double) );
+    e->lattice = malloc( replicas*sizeof(void *) );
+    e->sums = malloc( replicas*sizeof(long *) );
+    e->length = 0;
+    e->bytes = 0;
+    e->bins = malloc( replicas*sizeof(long) );
+    e->swap = calloc( replicas, sizeof(int) );
+    e->attempted = calloc( replicas, sizeof(long) );
+    e->accepted = calloc( replicas, sizeof(long) );
+    e->write = 0;
+    pthread_barrier_init( &e->barrier, NULL, replicas );
+}
+
+int EnsembleJoin( ensemble *e, int slot, void *lattice, long bytes, long sums[], int length, long bins ){
+    // register the configuration of a slot once its run is set up (bins = -1 if it could not be) and wait for the
+    // others; return 1 if every slot starts from the same bin, otherwise no slot may run
+    e->lattice[slot] = lattice;
+    e->sums[slot] = sums;
+    e->bins[slot] = bins;
+    if ( slot == 0 ){
+        e->length = length;
+        e->bytes = bytes;
+    }
+    pthread_barrier_wait( &e->barrier );
+    for ( int k=0; k<e->replicas; k++ ){
+        if ( e->bins[k] != e->bins[0] || e->bins[k] < 0 ){
+            if ( slot == 0 && e->bins[0] >= 0 && e->bins[k] >= 0 ){
+                printf( "The checkpoints of job %ld and job %ld are of different bins\n", e->ids[0], e->ids[k] );
+            }
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int EnsembleExchange( ensemble *e, int slot, double energy, long number ){
+    // offer swaps between the pairs of slots (0,1), (2,3), ... or (1,2), (3,4), ... by the parity of the exchange
+    // number; slot 0 draws them, then the lower slot of each accepted pair swaps the configurations and their sums;
+    // return 1 if the configuration of the slot changed
+    e->energy[slot] = energy;
+    pthread_barrier_wait( &e->barrier );
+    if ( slot == 0 ){
+        rng r;
+        RandomStream( &r, e->seed, StreamId( e->ids[0], 1+number ) );
+        for ( int k=0; k<e->replicas; k++ ){
+            e->swap[k] = 0;
+        }
+        for ( int k=number%2; k+1<e->replicas; k+=2 ){
+            double delta = (e->beta[k]-e->beta[k+1])*(e->energy[k]-e->energy[k+1]);
+            e->swap[k] = RandomUniform( &r ) < exp( delta );
+            e->attempted[k]++;
+            e->accepted[k] += e->swap[k];
+        }
+    }
+    pthread_barrier_wait( &e->barrier );
+    if ( e->swap[slot] ){
+        signed char *a = e->lattice[slot], *b = e->lattice[slot+1];
+        for ( long i=0; i<e->bytes; i++ ){
+            signed char s = a[i];
+            a[i] = b[i];
+            b[i] = s;
+        }
+        for ( int d=0; d<e->length && e->sums[slot]!=NULL; d++ ){
+            long s = e->sums[slot][d];
+            e->sums[slot][d] = e->sums[slot+1][d];
+            e->sums[slot+1][d] = s;
+        }
+    }
+    pthread_barrier_wait( &e->barrier );
+    return e->swap[slot] || (slot > 0 && e->swap[slot-1]);
+}
+
+int EnsembleCheckpoint( ensemble *e, int slot, int due ){
+    // return 1 to every slot if a checkpoint is due for slot 0, so all slots are written at the same bin
+    pthread_barrier_wait( &e->barrier );
+    if ( slot == 0 ){
+        e->write = due;
+    }
+    pthread_barrier_wait( &e->barrier );
+    return e->write;
+}
+
+void EnsembleFree( ensemble *e ){
+    // free the memory of an ensemble
+    pthread_barrier_destroy( &e->barrier );
+    free( e->jobs );
+    free( e->ids );
+    free( e->beta );
+    free( e->energy );
+    free( e->lattice );
+    free( e->sums );
+    free( e->bins );
+    free( e->swap );
+    free( e->attempted );
+    free( e->accepted );
+}
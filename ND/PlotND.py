@@ -0,0 +1,59 @@
+#Plotting data for the Ising Model in any dimension
+#Columns from left: dim, size, beta, mcs, bins_size, order, measure, layout, repetition, seed, separation, avg, sd
+
+import numpy as np
+import pandas as pd
+import matplotlib.pyplot as plt
+from matplotlib import style
+
+style.use( 'ggplot' ) #style of plot
+
+dim = 2 #dimension of the lattice
+beta = 0.6 #temperature
+SIZE = 64 #size of the lattice
+N = SIZE**dim #total number of sites
+
+#load the results of a sweep and keep one lattice and temperature
+df = pd.read_csv( 'Results_ND.csv' )
+df = df.loc[(df['dim'] == dim) & (df['size'] == SIZE) & (df['beta'].round( 2 ) == round( beta, 2 ))]
+
+MCS = int( df['mcs'].iloc[0] ) #total number of updates
+BS = int( df['bins_size'].iloc[0] ) #bin size
+labels = list( dict.fromkeys( df['order'] ) )
+separation = int( df['separation'].max() ) + 1
+
+#cols 2*n are for avg.s and cols 2*n+1 are for s.d.s
+mean = np.zeros( (separation, 2*len( labels )) )
+std = np.zeros( (separation, 2*len( labels )) )
+
+for j in range( 0, len( labels ), 1 ): #looping over methods
+    temp = df.loc[df['order'] == labels[j]].groupby( 'separation' )[['avg', 'sd']]
+    mean[:, 2*j:2*j+2] = temp.mean().to_numpy()
+    std[:, 2*j:2*j+2] = temp.std().to_numpy()
+
+x = np.arange( 0, separation, 1 )
+
+fig, ax = plt.subplots( nrows=1, ncols=2, sharex=True, figsize=(17, 6) )
+
+for i in range( 0, len( labels ), 1 ):
+    ax[0].errorbar( x, mean[:, 2*i], yerr=std[:, 2*i], capsize=3,
+                   label=labels[i].capitalize() )
+    ax[1].errorbar( x, mean[:, 2*i+1], yerr=std[:, 2*i+1], capsize=3,
+                   label=labels[i].capitalize() )
+
+ax[0].set_xlabel( 'Separation' )
+ax[0].set_ylabel( 'Mean Correlation' )
+ax[0].set_title( '%dD Ising Model \nCorrelation vs. Separation \n' % dim
+                +r'$(\beta=%.2f, N=%d, MCS=%d, BS=%d)$' % (beta, N, MCS, BS) )
+
+ax[1].set_xlabel( 'Separation' )
+ax[1].set_ylabel( 'Standard Deviation' )
+ax[1].set_title( '%dD Ising Model \nStandard Deviation of  Mean Correlation ' % dim
+                +'vs. Separation \n'
+                +r'$(\beta=%.2f, N=%d, MCS=%d, BS=%d)$' % (beta, N, MCS, BS) )
+
+ax[0].legend()
+ax[1].legend()
+
+plt.tight_layout()
+plt.show()
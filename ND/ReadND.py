@@ -0,0 +1,46 @@
+#Reading the binary output of the Ising Model in any dimension (--binary file) without a copy
+#The json header describes every array: the run parameters (one value per run), avg and sd (separation values per
+#run from values_start) and the raw bins (bins_number x separation values per run from bins_start)
+
+import json
+import numpy as np
+
+MAGIC = b'IMNDBIN1'
+
+def load( name ):
+    #map the file and return the header and a dict of numpy arrays that are views of the file
+    raw = np.memmap( name, dtype=np.uint8, mode='r' )
+    if bytes( raw[:8] ) != MAGIC:
+        raise ValueError( '%s is not a binary output of IMND' % name )
+    data, length = raw[8:24].view( '<u8' )
+    header = json.loads( bytes( raw[24:24+length] ).decode() )
+    arrays = {}
+    for array in header['arrays']:
+        dtype = np.dtype( array['dtype'] )
+        start = int( data ) + array['offset']
+        arrays[array['name']] = raw[start:start+array['count']*dtype.itemsize].view( dtype )
+    return header, arrays
+
+def names( header, arrays, column ):
+    #names of the codes of the order, measure or layout column
+    return np.array( header[column] )[arrays[column]]
+
+def results( arrays, j ):
+    #avg and sd of run j over the separations
+    start, count = arrays['values_start'][j], arrays['separation'][j]
+    return arrays['avg'][start:start+count], arrays['sd'][start:start+count]
+
+def bins( arrays, j ):
+    #raw bins of run j, one row per bin and one column per separation
+    start = arrays['bins_start'][j]
+    shape = (arrays['bins_number'][j], arrays['separation'][j])
+    return arrays['bins'][start:start+shape[0]*shape[1]].reshape( shape )
+
+if __name__ == '__main__':
+    import sys
+    header, arrays = load( sys.argv[1] if len( sys.argv ) > 1 else 'Results_ND.bin' )
+    orders = names( header, arrays, 'order' )
+    for j in range( header['jobs'] ):
+        avg, sd = results( arrays, j )
+        print( '%dD size %d beta %.2f %s repetition %d: %d bins, C(1) = %f +/- %f' % (arrays['dim'][j], arrays['size'][j],
+               arrays['beta'][j], orders[j], arrays['repetition'][j], arrays['bins_number'][j], avg[1], sd[1]) )
@@ -0,0 +1,47 @@
+#Plotting the autocorrelation analysis of the Ising Model in any dimension
+#Columns from left: dim, size, beta, mcs, order, measure, layout, repetition, seed, observable, mean, tau, tau_error,
+#window, tau_binning, effective_samples, cpu_seconds, samples_per_second
+
+import numpy as np
+import pandas as pd
+import matplotlib.pyplot as plt
+from matplotlib import style
+
+style.use( 'ggplot' ) #style of plot
+
+dim = 2 #dimension of the lattice
+SIZE = 64 #size of the lattice
+observable = 'energy' #energy, magnetisation or neighbour
+
+#load the analysis of a sweep and keep one lattice and observable
+df = pd.read_csv( 'Autocorrelation_ND.csv' )
+df = df.loc[(df['dim'] == dim) & (df['size'] == SIZE) & (df['observable'] == observable)]
+
+labels = list( dict.fromkeys( df['order'] ) )
+
+fig, ax = plt.subplots( nrows=1, ncols=2, sharex=True, figsize=(17, 6) )
+
+for label in labels: #looping over methods, averaging over repetitions
+    temp = df.loc[df['order'] == label].groupby( 'beta' )
+    betas = np.array( list( temp.groups.keys() ) )
+    ax[0].errorbar( betas, temp['tau'].mean(), yerr=temp['tau'].std(), capsize=3,
+                   label=label.capitalize() )
+    ax[1].errorbar( betas, temp['samples_per_second'].mean(), yerr=temp['samples_per_second'].std(), capsize=3,
+                   label=label.capitalize() )
+
+ax[0].set_xlabel( r'$\beta$' )
+ax[0].set_ylabel( 'Integrated Autocorrelation Time (sweeps)' )
+ax[0].set_title( '%dD Ising Model \nAutocorrelation Time of the %s vs. Temperature \n' % (dim, observable.capitalize())
+                +r'$(N=%d)$' % SIZE**dim )
+
+ax[1].set_xlabel( r'$\beta$' )
+ax[1].set_ylabel( 'Effective Samples per CPU-second' )
+ax[1].set_yscale( 'log' )
+ax[1].set_title( '%dD Ising Model \nIndependent Samples of the %s per CPU-second vs. Temperature \n' % (dim, observable.capitalize())
+                +r'$(N=%d)$' % SIZE**dim )
+
+ax[0].legend()
+ax[1].legend()
+
+plt.tight_layout()
+plt.show()